@@ -0,0 +1,92 @@
+#ifndef __allocation_counter_header_guard__
+#define __allocation_counter_header_guard__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+
+// Counting the heap allocations made by a region of code, for the tests and the benchmarks:
+//
+//   allocation_count allocations{};
+//   ... the region ...
+//   REQUIRE( allocations() == 0 );
+//
+// The counting is done by replacing the global operator new, which every standard container and
+// every new expression go through. The replacement can only be defined once per program: define
+// COUNT_ALLOCATIONS before including this header in exactly one translation unit.
+// Only the calling thread is counted, other threads can allocate meanwhile without spoiling the count.
+// Direct calls to malloc() are not counted: nothing in list_pool makes any.
+
+// the number of allocations made by the calling thread since it started
+inline std::uint64_t& thread_allocations() noexcept {
+    static thread_local std::uint64_t allocations{ 0 };
+    return allocations;
+}
+
+// the allocations made by the calling thread since the construction
+class allocation_count {
+    std::uint64_t start;
+
+    public:
+    allocation_count() noexcept : start{ thread_allocations() } {}
+
+    std::uint64_t operator () () const noexcept {
+        return thread_allocations() - start;
+    }
+};
+
+
+#ifdef COUNT_ALLOCATIONS
+
+// GCC does not know that this operator new is malloc() and warns about every free() below
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    ++thread_allocations();
+    if ( void* p = std::malloc( size == 0 ? 1 : size ) ) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+void* operator new[](std::size_t size) {
+    return ::operator new( size );
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++thread_allocations();
+    return std::malloc( size == 0 ? 1 : size );
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return ::operator new( size, tag );
+}
+
+void operator delete(void* p) noexcept {
+    std::free( p );
+}
+void operator delete[](void* p) noexcept {
+    std::free( p );
+}
+void operator delete(void* p, std::size_t) noexcept {
+    std::free( p );
+}
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free( p );
+}
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free( p );
+}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free( p );
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+#endif // COUNT_ALLOCATIONS
+
+#endif // __allocation_counter_header_guard__
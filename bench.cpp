@@ -0,0 +1,569 @@
+// Benchmarks for list_pool, run them with `make benchmark`.
+// Every case prints one line: its name, the time and the heap allocations per operation (per push,
+// per node traversed, ...), followed by the hardware counters per operation when perf events are available.
+// The steady-state cases fail the run if they allocate at all.
+
+#define COUNT_ALLOCATIONS
+#include "allocation_counter.hpp"
+
+#include "list_pool.hpp"
+#include "operation_log.hpp"
+#include "pool_observers.hpp"
+#include "perf_counters.hpp"
+#include "hdr_histogram.hpp"
+#include "small_list.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+
+// keeps the compiler from optimizing away a result
+template <typename T>
+void do_not_optimize(const T& value) {
+    asm volatile( "" : : "r,m"(value) : "memory" );
+}
+
+// runs f() once and returns the elapsed nanoseconds
+template <typename F>
+double time_ns(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>( stop - start ).count();
+}
+
+// the counters are opened once for the whole run
+perf_counters& counters() {
+    static perf_counters instance{};
+    return instance;
+}
+
+// runs f() once, which does operations operations of the given unit, prints the cost per operation
+// and returns the number of allocations made by f()
+template <typename F>
+std::uint64_t measure(const std::string& name, std::size_t operations, const char* unit, F&& f) {
+    allocation_count allocations{};
+    counters().start();
+    double ns{ time_ns( std::forward<F>(f) ) };
+    const auto& counted = counters().stop();
+    std::uint64_t allocated{ allocations() };
+    std::printf( "%-48s %10.1f ns/%s %10.4f allocs/%s\n", name.c_str(), ns / double(operations), unit,
+            double(allocated) / double(operations), unit );
+    if ( counters().available() ) {
+        std::printf( "%-48s", "" );
+        for ( const auto& c : counted ) {
+            std::printf( " %s %.2f", c.name.c_str(), double(c.value) / double(operations) );
+        }
+        std::printf( "\n" );
+    }
+    return allocated;
+}
+
+
+// push/free churn on a few lists: the workload logged by the write-ahead log cases
+template <typename Pool>
+void churn(Pool& pool, std::size_t operations) {
+    auto l1 = pool.new_list();
+    auto l2 = pool.new_list();
+    for ( std::size_t i{0}; i < operations / 4; ++i ) {
+        l1 = pool.push_front( int(i), l1 );
+        l2 = pool.push_front( int(i), l2 );
+        l1 = pool.free( l1 );
+        l2 = pool.free( l2 );
+    }
+    do_not_optimize( l1 );
+    do_not_optimize( l2 );
+    do_not_optimize( pool.size() );
+}
+
+void bench_write_ahead_log() {
+    const std::string path{ "bench_wal.log" };
+    {
+        const std::size_t operations{ std::size_t(1) << 20 };
+        list_pool<int, std::size_t> pool{};
+        measure( "churn, no log", operations, "op", [&]{ churn( pool, operations ); } );
+    }
+    // the group size is the number of operations per write() + fdatasync()
+    for ( std::size_t group : { 1, 16, 256, 4096 } ) {
+        // flushing every operation is way slower, a smaller run is enough
+        const std::size_t operations{ group == 1 ? std::size_t(1) << 12 : std::size_t(1) << 18 };
+        std::remove( path.c_str() );
+        list_pool<int, std::size_t, vector_storage, write_ahead_log> pool{};
+        pool.operation_log().open( path, group );
+        measure( "churn, write-ahead log, group of " + std::to_string(group), operations, "op", 
+                [&]{ churn( pool, operations ); pool.operation_log().commit(); } );
+    }
+    std::remove( path.c_str() );
+}
+
+
+// pushing into a pool, with and without reserving the nodes in advance
+void bench_push() {
+    const std::size_t pushes{ std::size_t(1) << 22 };
+    {
+        list_pool<int, std::uint32_t> pool{};
+        auto l = pool.new_list();
+        measure( "push_front, no reserve", pushes, "push", [&]{
+            for ( std::size_t i{0}; i < pushes; ++i ) {
+                l = pool.push_front( int(i), l );
+            }
+        } );
+        do_not_optimize( l );
+    }
+    {
+        list_pool<int, std::uint32_t> pool{ pushes };
+        auto l = pool.new_list();
+        measure( "push_front, reserved", pushes, "push", [&]{
+            for ( std::size_t i{0}; i < pushes; ++i ) {
+                l = pool.push_front( int(i), l );
+            }
+        } );
+        do_not_optimize( l );
+    }
+}
+
+// Per-call latency distributions of the four mutating operations, each call timed with the
+// timestamp counter (the two reads add a few ns to every sample): the mean of bench_push hides the
+// calls that reallocate the whole storage, p99.9 and max show them. The pool is either not reserved,
+// reserved for half of the nodes or for all of them, and the pushes round-robin over many lists.
+// The allocations per operation are those of each whole phase (the histograms never allocate).
+template <template<typename> class Storage>
+void bench_latency(const char* storage) {
+    const std::size_t nodes{ std::size_t(1) << 20 }, lists{ 1024 };
+    const std::size_t appended{ nodes / 16 }; // push_back walks to the tail, keep the lists short for it
+    const double scale{ ns_per_tick() };
+    auto report = [&]( const char* op, const char* reserve, const hdr_histogram& h, std::uint64_t allocated ) {
+        std::string name{ std::string("latency, ") + op + ", " + storage + ", " + reserve };
+        std::printf( "%-48s p50 %6.0f  p99 %6.0f  p99.9 %7.0f  max %9.0f ns %10.4f allocs/op\n", name.c_str(),
+                double( h.percentile(50) ) * scale, double( h.percentile(99) ) * scale,
+                double( h.percentile(99.9) ) * scale, double( h.max() ) * scale,
+                double(allocated) / double( h.count() ) );
+    };
+    for ( std::size_t reserved : { std::size_t(0), nodes / 2, nodes } ) {
+        const char* reserve{ reserved == 0 ? "no reserve" : reserved < nodes ? "half reserved" : "reserved" };
+        list_pool<int, std::uint32_t, Storage> pool{ reserved };
+        std::vector<std::uint32_t> heads( lists, pool.new_list() );
+        hdr_histogram h{};
+
+        allocation_count allocations{};
+        for ( std::size_t i{0}; i < appended; ++i ) {
+            auto& head = heads[ i % lists ];
+            std::uint64_t start{ pool_timestamp() };
+            head = pool.push_back( int(i), head );
+            h.record( pool_timestamp() - start );
+        }
+        report( "push_back", reserve, h, allocations() );
+
+        h.reset();
+        allocations = allocation_count{};
+        for ( std::size_t i{appended}; i < nodes; ++i ) {
+            auto& head = heads[ i % lists ];
+            std::uint64_t start{ pool_timestamp() };
+            head = pool.push_front( int(i), head );
+            h.record( pool_timestamp() - start );
+        }
+        report( "push_front", reserve, h, allocations() );
+
+        // the first half of the lists is freed a node at a time, the second half a list at a time
+        h.reset();
+        allocations = allocation_count{};
+        for ( std::size_t l{0}; l < lists / 2; ++l ) {
+            while ( not pool.is_empty( heads[l] ) ) {
+                std::uint64_t start{ pool_timestamp() };
+                heads[l] = pool.free( heads[l] );
+                h.record( pool_timestamp() - start );
+            }
+        }
+        report( "free", reserve, h, allocations() );
+
+        h.reset();
+        allocations = allocation_count{};
+        for ( std::size_t l{lists / 2}; l < lists; ++l ) {
+            std::uint64_t start{ pool_timestamp() };
+            pool.free_list( heads[l] );
+            h.record( pool_timestamp() - start );
+        }
+        report( "free_list", reserve, h, allocations() );
+        do_not_optimize( pool.size() );
+    }
+}
+
+// a list whose nodes are laid out in traversal order against one whose nodes are shuffled
+// all over the pool (as after a lot of churn): the difference is all cache and TLB misses
+void bench_traversal() {
+    const std::size_t nodes{ std::size_t(1) << 22 };
+    for ( bool shuffled : { false, true } ) {
+        list_pool<int, std::uint32_t> pool{ nodes };
+        auto l = pool.new_list();
+        if ( shuffled ) {
+            // fill the pool, free the nodes in random order and rebuild the list from the free_node_list
+            std::vector<std::uint32_t> order( nodes );
+            for ( std::size_t i{0}; i < nodes; ++i ) {
+                order[i] = pool.push_front( int(i), pool.new_list() );
+            }
+            std::shuffle( order.begin(), order.end(), std::mt19937{ 42 } );
+            for ( auto node : order ) {
+                pool.free( node );
+            }
+        }
+        for ( std::size_t i{0}; i < nodes; ++i ) {
+            l = pool.push_front( int(i), l );
+        }
+        long sum{ 0 };
+        measure( shuffled ? "traversal, shuffled nodes" : "traversal, contiguous nodes", nodes, "node", [&]{
+            sum = std::accumulate( pool.cbegin(l), pool.cend(l), 0L );
+        } );
+        do_not_optimize( sum );
+    }
+}
+
+
+// the resident set of the process in KB (Linux only)
+long resident_kb() {
+    long pages{ 0 }, resident{ 0 };
+    if ( std::FILE* statm = std::fopen( "/proc/self/statm", "r" ) ) {
+        if ( std::fscanf( statm, "%ld %ld", &pages, &resident ) != 2 ) {
+            resident = 0;
+        }
+        std::fclose( statm );
+    }
+    return resident * ( ::sysconf( _SC_PAGESIZE ) / 1024 );
+}
+
+// How the pool decays under long-running churn, without and with the cures: lists start contiguous,
+// then random pushes and frees over many lists (balanced around a fixed number of live nodes) and
+// bursts of free_list scramble the free_node_list. At the end of each round a quarter of the lists is
+// freed and rebuilt one after the other, as a reload would: each rebuilt list takes its nodes from the
+// free_node_list in a row, so its locality is the order of the free list. Then the traversal of all
+// the lists is timed, with the share of links to an adjacent node (the locality) and the resident set.
+// The cures run before the rebuild: sort_free_list(), or compact() (after the rebuild).
+void bench_fragmentation() {
+    const std::size_t live{ std::size_t(1) << 20 }, lists{ 4096 }, length{ live / lists }, operations{ live }, rounds{ 6 };
+    enum class cure { none, sorted_free_list, compaction };
+    for ( cure c : { cure::none, cure::sorted_free_list, cure::compaction } ) {
+        const char* name{ c == cure::none ? "lifo free list" : c == cure::sorted_free_list ? "sorted free list" : "compaction" };
+        list_pool<int, std::uint32_t> pool{ live + live / 4 };
+        std::vector<std::uint32_t> heads( lists, pool.new_list() );
+        for ( auto& head : heads ) {
+            for ( std::size_t i{0}; i < length; ++i ) {
+                head = pool.push_front( int(i), head );
+            }
+        }
+        std::size_t nodes{ live };
+        std::mt19937 random{ 42 };
+        auto count = [&pool]( std::uint32_t head ) {
+            return std::size_t( std::distance( pool.cbegin(head), pool.cend(head) ) );
+        };
+
+        for ( std::size_t round{0}; round <= rounds; ++round ) {
+            allocation_count allocations{}; // those of the churn and of the cure, per operation of churn
+            if ( round > 0 ) {
+                for ( std::size_t i{0}; i < operations; ++i ) {
+                    auto& head = heads[ random() % lists ];
+                    if ( i % 65536 == 0 ) {
+                        // a burst: a few whole lists go back to the free_node_list
+                        for ( int burst{0}; burst < 16; ++burst ) {
+                            auto& victim = heads[ random() % lists ];
+                            nodes -= count( victim );
+                            victim = pool.free_list( victim );
+                        }
+                    }
+                    // pushing is more likely below the target of live nodes, freeing above it
+                    if ( random() % ( 2 * live ) >= nodes or pool.is_empty(head) ) {
+                        head = pool.push_front( int(i), head );
+                        ++nodes;
+                    } else {
+                        head = pool.free( head );
+                        --nodes;
+                    }
+                }
+                // the rebuild: a quarter of the lists, freed first, then filled again one list at a time
+                std::vector<std::size_t> rebuilt( lists / 4 );
+                for ( auto& l : rebuilt ) {
+                    l = random() % lists;
+                    nodes -= count( heads[l] );
+                    heads[l] = pool.free_list( heads[l] );
+                }
+                if ( c == cure::sorted_free_list ) {
+                    pool.sort_free_list();
+                }
+                for ( auto l : rebuilt ) {
+                    for ( std::size_t i{0}; i < length; ++i ) {
+                        heads[l] = pool.push_front( int(i), heads[l] );
+                    }
+                    nodes += length;
+                }
+                if ( c == cure::compaction ) {
+                    pool.compact( heads );
+                }
+            }
+            std::uint64_t allocated{ allocations() };
+            std::size_t adjacent{ 0 };
+            for ( auto head : heads ) {
+                for ( auto index = head; not pool.is_empty(index); index = pool.next(index) ) {
+                    auto next = pool.next(index);
+                    adjacent += ( next == index + 1 or next + 1 == index );
+                }
+            }
+            long sum{ 0 };
+            auto traverse = [&]{
+                for ( auto head : heads ) {
+                    sum = std::accumulate( pool.cbegin(head), pool.cend(head), sum );
+                }
+            };
+            traverse(); // the same cache state for every measurement
+            double ns{ time_ns( traverse ) };
+            do_not_optimize( sum );
+            std::printf( "%-48s %10.1f ns/node %6.1f %% adjacent %8ld KB %10.4f allocs/op\n",
+                    ( std::string("fragmentation, ") + name + ", round " + std::to_string(round) ).c_str(),
+                    ns / double(nodes), 100.0 * double(adjacent) / double(nodes), resident_kb(),
+                    round == 0 ? 0.0 : double(allocated) / double(operations) );
+        }
+    }
+}
+
+// A skewed workload: 1% of the lists receive 90% of the traversals. Their nodes start interleaved with
+// those of all the other lists (they are built round-robin), then segregate() packs them at the front
+// of the pool, according to the counts of the access sampler.
+void bench_hot_cold() {
+    const std::size_t lists{ std::size_t(1) << 16 }, length{ 16 }, hot{ lists / 100 }, traversals{ std::size_t(1) << 20 };
+    using pool_type = list_pool<int, std::uint32_t, vector_storage, no_log, access_sampler<16, (1 << 16)>>;
+    pool_type pool{ lists * length };
+    std::vector<std::uint32_t> heads( lists, pool.new_list() );
+    for ( std::size_t i{0}; i < lists * length; ++i ) {
+        heads[ i % lists ] = pool.push_front( int(i), heads[ i % lists ] );
+    }
+    // the hot lists are spread over the whole pool
+    std::mt19937 random{ 42 };
+    std::vector<std::uint32_t> picks( traversals );
+    for ( auto& pick : picks ) {
+        pick = std::uint32_t( random() % 10 != 0 ? ( random() % hot ) * ( lists / hot ) : random() % lists );
+    }
+    auto workload = [&]{
+        long sum{ 0 };
+        for ( auto pick : picks ) {
+            sum = std::accumulate( pool.begin(heads[pick]), pool.end(heads[pick]), sum ); // the sampler counts non-const traversals
+        }
+        do_not_optimize( sum );
+    };
+    measure( "skewed traversals, hot lists scattered", traversals * length, "node", workload );
+    pool.segregate( heads, [&pool](std::uint32_t head) { return pool.observer().heat( head ); } );
+    pool.observer().reset();
+    measure( "skewed traversals, hot lists segregated", traversals * length, "node", workload );
+}
+
+// Many short lists (0 to 4 values, 1.6 on average), built in random order so that their nodes are
+// scattered: plain heads of list_pool against small_list handles keeping 3 values inline, which only
+// go through the pool for the rare fourth value.
+void bench_small_lists() {
+    const std::size_t lists{ std::size_t(1) << 18 }, rounds{ 8 };
+    using pool_type = list_pool<int, std::uint32_t>;
+    std::mt19937 random{ 42 };
+    std::vector<std::size_t> order;
+    for ( std::size_t i{0}; i < lists; ++i ) {
+        std::size_t length{ random() % 8 == 0 ? 4 : random() % 3 };
+        order.insert( order.end(), length, i );
+    }
+    std::shuffle( order.begin(), order.end(), random );
+
+    pool_type plain{};
+    std::vector<std::uint32_t> heads( lists, plain.new_list() );
+    pool_type spilled{};
+    std::vector<small_list<pool_type, 3>> small;
+    small.reserve( lists );
+    for ( std::size_t i{0}; i < lists; ++i ) {
+        small.emplace_back( spilled );
+    }
+    measure( "short lists, build, plain heads", order.size(), "push", [&]{
+        for ( auto i : order ) {
+            heads[i] = plain.push_front( int(i), heads[i] );
+        }
+    } );
+    measure( "short lists, build, 3 values inline", order.size(), "push", [&]{
+        for ( auto i : order ) {
+            small[i].push_front( spilled, int(i) );
+        }
+    } );
+    measure( "short lists, traversal, plain heads", rounds * order.size(), "value", [&]{
+        long sum{ 0 };
+        for ( std::size_t round{0}; round < rounds; ++round ) {
+            for ( auto head : heads ) {
+                sum = std::accumulate( plain.cbegin( head ), plain.cend( head ), sum );
+            }
+        }
+        do_not_optimize( sum );
+    } );
+    measure( "short lists, traversal, 3 values inline", rounds * order.size(), "value", [&]{
+        long sum{ 0 };
+        for ( std::size_t round{0}; round < rounds; ++round ) {
+            for ( const auto& list : small ) {
+                sum = std::accumulate( list.begin( spilled ), list.end( spilled ), sum );
+            }
+        }
+        do_not_optimize( sum );
+    } );
+    std::printf( "%-48s %zu nodes for plain heads, %zu for small lists\n", "short lists, pool size",
+            std::size_t( plain.size() ), std::size_t( spilled.size() ) );
+}
+
+// Merging the pools of 16 shards of 64K nodes each, then extracting 1% of the lists back out.
+void bench_absorb_extract() {
+    const std::size_t shards{ 16 }, nodes{ std::size_t(1) << 16 }, lists{ 1024 };
+    using pool_type = list_pool<int, std::uint32_t>;
+    std::vector<pool_type> pools( shards );
+    std::vector<std::uint32_t> heads;
+    for ( std::size_t s{0}; s < shards; ++s ) {
+        std::vector<std::uint32_t> shard_heads( lists, pools[s].new_list() );
+        for ( std::size_t i{0}; i < nodes; ++i ) {
+            shard_heads[ i % lists ] = pools[s].push_front( int(i), shard_heads[ i % lists ] );
+        }
+        heads.insert( heads.end(), shard_heads.begin(), shard_heads.end() );
+    }
+    pool_type merged{};
+    measure( "absorb 16 shards", shards * nodes, "node", [&]{
+        for ( std::size_t s{0}; s < shards; ++s ) {
+            std::uint32_t offset{ merged.absorb( pools[s] ) };
+            for ( std::size_t i{ s * lists }; i < (s + 1) * lists; ++i ) {
+                heads[i] += offset;
+            }
+        }
+    } );
+    std::vector<std::uint32_t> shipped;
+    for ( std::size_t i{0}; i < heads.size(); i += 100 ) {
+        shipped.push_back( heads[i] );
+    }
+    std::size_t copied{ shipped.size() * nodes / lists };
+    measure( "extract 1% of the lists", copied, "node", [&]{
+        do_not_optimize( merged.extract( shipped ).size() );
+    } );
+}
+
+// Once a pool has reached its working size, pushing and freeing within capacity() must never touch
+// the heap: the nodes come from the free_node_list. Returns false if the churn allocated anything.
+template <typename Pool>
+bool steady_state(const std::string& name) {
+    const std::size_t nodes{ std::size_t(1) << 16 }, lists{ 64 }, operations{ std::size_t(1) << 22 };
+    Pool pool{ nodes };
+    std::vector<typename Pool::list_type> heads( lists, pool.new_list() );
+    for ( std::size_t i{0}; i < nodes; ++i ) {
+        heads[ i % lists ] = pool.push_front( int(i), heads[ i % lists ] );
+    }
+    std::uint64_t allocations{ measure( "steady-state churn, " + name, operations, "op", [&]{
+        for ( std::size_t i{0}; i < operations / 2; ++i ) {
+            auto& head = heads[ i % lists ];
+            if ( i % 4096 == 0 ) {
+                // a whole list goes back to the free_node_list and is rebuilt from it
+                pool.free_list( head );
+                head = pool.new_list();
+                for ( std::size_t n{0}; n < nodes / lists; ++n ) {
+                    head = pool.push_front( int(n), head );
+                }
+            }
+            head = pool.free( head );
+            head = pool.push_front( int(i), head );
+        }
+    } ) };
+    do_not_optimize( pool.size() );
+    if ( allocations != 0 ) {
+        std::printf( "FAILED: %llu allocations in the steady state of %s, expected none\n",
+                (unsigned long long)( allocations ), name.c_str() );
+    }
+    return allocations == 0;
+}
+
+bool bench_steady_state() {
+    bool ok{ true };
+    ok &= steady_state<list_pool<int, std::uint32_t>>( "vector" );
+    ok &= steady_state<list_pool<int, std::uint32_t, chunked_storage>>( "chunked" );
+    ok &= steady_state<list_pool<int, std::uint32_t, vector_storage, no_log, counting_observer>>( "counting observer" );
+    ok &= steady_state<list_pool<int, std::uint32_t, vector_storage, no_log, latency_observer<64>>>( "latency observer" );
+    return ok;
+}
+
+// the cost of the instrumentation: the default observer must cost nothing
+void bench_observers() {
+    const std::size_t operations{ std::size_t(1) << 22 };
+    {
+        list_pool<int, std::size_t> pool{};
+        measure( "churn, no observer", operations, "op", [&]{ churn( pool, operations ); } );
+    }
+    {
+        list_pool<int, std::size_t, vector_storage, no_log, counting_observer> pool{};
+        measure( "churn, counting observer", operations, "op", [&]{ churn( pool, operations ); } );
+    }
+    {
+        list_pool<int, std::size_t, vector_storage, no_log, latency_observer<64>> pool{};
+        measure( "churn, latency observer (1 in 64)", operations, "op", [&]{ churn( pool, operations ); } );
+    }
+    {
+        list_pool<int, std::size_t, vector_storage, no_log, latency_observer<1>> pool{};
+        measure( "churn, latency observer (every op)", operations, "op", [&]{ churn( pool, operations ); } );
+    }
+}
+
+// raw save() against save_compressed(), both for size and for decoding speed
+void bench_compressed_format() {
+    const std::size_t lists{ 1024 }, length{ 1024 };
+    list_pool<int, std::uint32_t> pool{ lists * length };
+    std::vector<std::uint32_t> heads( lists, pool.new_list() );
+    // each list is built in one go, so its nodes are contiguous, as after a compaction
+    for ( auto& head : heads ) {
+        for ( std::size_t i{0}; i < length; ++i ) {
+            head = pool.push_front( int(i % 1000), head );
+        }
+    }
+
+    // the allocations of each call, those of the growing stream included
+    std::stringstream raw, packed, varint;
+    pool.save( raw );
+    allocation_count allocations{};
+    pool.save_compressed( packed, heads );
+    std::uint64_t allocated{ allocations() };
+    double raw_bytes{ double( raw.str().size() ) };
+    std::printf( "%-48s %10.2f x %10llu allocs\n", "compression ratio, raw values",
+            raw_bytes / double( packed.str().size() ), (unsigned long long)( allocated ) );
+    allocations = allocation_count{};
+    pool.save_compressed( varint, heads, list_pool_codec::varint{} );
+    allocated = allocations();
+    std::printf( "%-48s %10.2f x %10llu allocs\n", "compression ratio, varint values",
+            raw_bytes / double( varint.str().size() ), (unsigned long long)( allocated ) );
+
+    // decoding speed is measured in bytes of the raw format produced per second
+    list_pool<int, std::uint32_t> loaded{};
+    auto decode = [&]( const char* name, auto&& f ) {
+        allocation_count decoding{};
+        double ns{ time_ns( f ) };
+        std::printf( "%-48s %10.2f GB/s %10llu allocs\n", name, raw_bytes / ns, (unsigned long long)( decoding() ) );
+    };
+    decode( "decode, raw", [&]{ loaded.load( raw ); } );
+    decode( "decode, compressed raw values", [&]{ do_not_optimize( loaded.load_compressed( packed ) ); } );
+    decode( "decode, compressed varint values", [&]{ do_not_optimize( loaded.load_compressed( varint, list_pool_codec::varint{} ) ); } );
+}
+
+
+int main() {
+    if ( not counters().available() ) {
+        std::printf( "perf events are not available, timing only\n" );
+    }
+    bench_push();
+    bench_latency<vector_storage>( "vector" );
+    bench_latency<chunked_storage>( "chunked" );
+    bench_traversal();
+    bench_fragmentation();
+    bench_hot_cold();
+    bench_small_lists();
+    bench_absorb_extract();
+    bench_write_ahead_log();
+    bench_compressed_format();
+    bench_observers();
+    return bench_steady_state() ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+#ifndef __circular_list_pool_header_guard__
+#define __circular_list_pool_header_guard__
+
+#include "list_pool.hpp"
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+// Circular lists: the last node links back to the first, and a list is identified by its tail, whose next
+// is the head. The tail and the head are both one step away, so push_front(), push_back(), concat(), rotate()
+// and free_list() are all O(1), where a list of list_pool has to walk to its tail for push_back() or free_list().
+// The nodes live in a plain list_pool (with its free list), index 0 is still the empty list, and every
+// operation returns the new tail. The iterators start at the head and stop after one lap.
+// The links of a ring are set through list_pool::next(), which the write-ahead log does not see: the pool
+// has no Log policy.
+template <typename Value, typename Index = std::size_t, template <typename> class Storage = vector_storage>
+class circular_list_pool {
+    public:
+    using pool_type = list_pool<Value, Index, Storage>;
+    using value_type = Value;
+    using list_type = Index;
+    using size_type = typename pool_type::size_type;
+
+    private:
+    pool_type pool;
+
+    public:
+    // a forward iterator over one lap of a ring, from its head to its tail
+    class const_iterator {
+        friend circular_list_pool;
+
+        const circular_list_pool* owner;
+        Index current;
+        Index tail;
+
+        const_iterator(const circular_list_pool* owner, Index current, Index tail) noexcept
+            : owner{ owner },
+            current{ current },
+            tail{ tail }
+        {}
+
+        public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Value*;
+        using reference = const Value&;
+
+        reference operator * () const {
+            return (*self.owner).value( self.current );
+        }
+        pointer operator -> () const {
+            return &**this;
+        }
+        const_iterator& operator ++ () {
+            // the lap ends at the tail
+            self.current = self.current == self.tail ? (*self.owner).end() : (*self.owner).next( self.current );
+            return self;
+        }
+        const_iterator operator ++ (int) {
+            const_iterator old{ self };
+            ++self;
+            return old;
+        }
+        bool operator == (const const_iterator& other) const noexcept {
+            return self.current == other.current;
+        }
+        bool operator != (const const_iterator& other) const noexcept {
+            return not ( self == other );
+        }
+    };
+
+    circular_list_pool() = default;
+    explicit circular_list_pool(size_type n) : pool{ n } {}
+
+    Index new_list() noexcept {
+        return self.pool.new_list();
+    }
+    bool is_empty(Index tail) const noexcept {
+        return self.pool.is_empty( tail );
+    }
+    Index end() const noexcept {
+        return self.pool.end();
+    }
+
+    // the head is the new node, the tail does not change (unless the ring was empty)
+    Index push_front(Value value, Index tail) {
+        if ( self.is_empty( tail ) ) {
+            Index node{ self.pool.push_front( std::move(value), self.end() ) };
+            self.pool.next( node ) = node;
+            return node;
+        }
+        Index node{ self.pool.push_front( std::move(value), self.pool.next( tail ) ) };
+        self.pool.next( tail ) = node;
+        return tail;
+    }
+    // the same link as push_front(), but the new node becomes the tail
+    Index push_back(Value value, Index tail) {
+        Index node{ self.push_front( std::move(value), tail ) };
+        return self.is_empty( tail ) ? node : self.pool.next( tail );
+    }
+    // the ring of a followed by the ring of b, by swapping the links of their tails; returns the tail of b.
+    // Both rings are consumed, only the returned tail identifies the result.
+    Index concat(Index a, Index b) {
+        if ( self.is_empty( a ) ) {
+            return b;
+        }
+        if ( self.is_empty( b ) ) {
+            return a;
+        }
+        std::swap( self.pool.next( a ), self.pool.next( b ) );
+        return b;
+    }
+    // the first n values move to the back, one step per value
+    Index rotate(Index tail, std::size_t n = 1) {
+        for ( ; n > 0 and not self.is_empty( tail ); --n ) {
+            tail = self.pool.next( tail );
+        }
+        return tail;
+    }
+    // removes the head
+    Index free(Index tail) {
+        if ( self.is_empty( tail ) ) {
+            return tail;
+        }
+        Index head{ self.pool.next( tail ) };
+        if ( head == tail ) {
+            self.pool.free( tail );
+            return self.new_list();
+        }
+        self.pool.next( tail ) = self.pool.next( head );
+        self.pool.free( head );
+        return tail;
+    }
+    // Splices the whole ring into the free list of the pool, in O(1): freeing the head puts it in front
+    // of the free list, then its successors are linked back after it and the tail closes on the rest
+    // of the free list.
+    Index free_list(Index tail) {
+        if ( self.is_empty( tail ) ) {
+            return tail;
+        }
+        Index head{ self.pool.next( tail ) };
+        if ( head == tail ) {
+            self.pool.free( tail );
+            return self.new_list();
+        }
+        Index second{ self.pool.free( head ) };
+        Index rest{ self.pool.next( head ) }; // the free list the head was pushed onto
+        self.pool.next( head ) = second;
+        self.pool.next( tail ) = rest;
+        return self.new_list();
+    }
+
+    const Value& front(Index tail) const {
+        return self.value( self.next( tail ) );
+    }
+    const Value& back(Index tail) const {
+        return self.value( tail );
+    }
+    Value& value(Index index) {
+        return self.pool.value( index );
+    }
+    const Value& value(Index index) const {
+        return self.pool.value( index );
+    }
+    Index next(Index index) const {
+        return self.pool.next( index );
+    }
+    // the values in the ring, O(length)
+    std::size_t length(Index tail) const {
+        return std::size_t( std::distance( self.begin( tail ), self.end( tail ) ) );
+    }
+
+    const_iterator begin(Index tail) const {
+        return const_iterator{ &self, self.is_empty( tail ) ? self.end() : self.next( tail ), tail };
+    }
+    const_iterator end(Index tail) const noexcept {
+        return const_iterator{ &self, self.end(), tail };
+    }
+
+    void reserve(size_type n) {
+        self.pool.reserve( n );
+    }
+    size_type size() const noexcept {
+        return self.pool.size();
+    }
+    size_type capacity() const noexcept {
+        return self.pool.capacity();
+    }
+    // the underlying pool, e.g. for its memory_report()
+    const pool_type& nodes() const noexcept {
+        return self.pool;
+    }
+};
+
+#undef self
+#endif // __circular_list_pool_header_guard__
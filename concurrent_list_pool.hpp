@@ -0,0 +1,313 @@
+#ifndef __concurrent_list_pool_header_guard__
+#define __concurrent_list_pool_header_guard__
+
+#include "list_pool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+// A list_pool shared by one writer thread and many reader threads.
+// Readers are optimistic (a seqlock): they take no lock and write nothing shared, they simply
+// read the sequence counter before and after a traversal and retry if a write happened in between.
+// This requires nodes that never move, hence the pool is always backed by chunked_storage.
+//
+// While a write is in progress a reader can observe a half-done mutation, this is fine because:
+//  - nodes never move and every next index is always in range, so a reader never reads freed memory;
+//  - values are trivially copyable (checked at compile time): a value owning a buffer, like a std::string,
+//    could be reassigned by the writer while a reader copies it, and the reader would follow a pointer
+//    to the buffer just freed before the validation can reject the copy;
+//  - every mutation keeps the lists (and the free_node_list) acyclic, so a traversal always terminates;
+//  - the result of such a traversal is thrown away by the validation.
+//
+// Readers can also pin an epoch instead (epoch-based reclamation): free() and free_list() do not
+// give the nodes back to the pool right away, they park them in the limbo list of the current epoch.
+// The limbo of an epoch is spliced into the free_node_list (in bulk) only once every pinned reader
+// has moved past it, so a node can never be reused while a reader might still be standing on it.
+// A pinned reader can traverse lists without validating, as long as the values it reads
+// are not assigned in place through write().
+template <typename Value, typename Index = std::size_t>
+class concurrent_list_pool {
+    static_assert( std::is_trivially_copyable<Value>::value, "the optimistic readers copy values that may be written meanwhile" );
+
+    public:
+    using pool_type = list_pool<Value, Index, chunked_storage>;
+
+    private:
+    using Sequence = std::size_t;
+    using Epoch = std::size_t;
+
+    static constexpr Epoch idle = Epoch(-1);
+    // the writer tries to advance the epoch every so many retirements
+    static constexpr std::size_t advance_period = 64;
+
+    // each reader announces the epoch it is pinned in, in a cache line of its own: 
+    // the slots are 64 bytes apart, so no two of them can share a line (C++14 has no aligned new)
+    struct reader_slot {
+        std::atomic<Epoch> epoch;
+        std::atomic<bool> used;
+        char padding[ 64 - sizeof(std::atomic<Epoch>) - sizeof(std::atomic<bool>) ];
+    };
+
+    // a retired run of nodes: either a whole list or a single node, whose next must not be followed
+    struct retired {
+        Index first;
+        bool single;
+    };
+
+    pool_type pool;
+    // the counter lives in a cache line of its own, so readers only share a line that is written once per write.
+    // The same holds for the epoch, which is written once per reclamation.
+    char padding0[64];
+    std::atomic<Sequence> sequence;
+    char padding1[64];
+    std::atomic<Epoch> epoch;
+    char padding2[64];
+    std::unique_ptr<reader_slot[]> slots;
+    std::size_t max_readers;
+    // the nodes retired in epoch e wait in limbo[e % 3]
+    std::vector<retired> limbo[3];
+    std::size_t retirements;
+
+    // an odd sequence means that a write is in progress
+    class write_section {
+        concurrent_list_pool& owner;
+
+        public:
+        explicit write_section(concurrent_list_pool& owner) noexcept
+            : owner{ owner }
+        {
+            Sequence current{ owner.sequence.load(std::memory_order_relaxed) };
+            owner.sequence.store( current + 1, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_release );
+        }
+        ~write_section() {
+            Sequence current{ owner.sequence.load(std::memory_order_relaxed) };
+            owner.sequence.store( current + 1, std::memory_order_release );
+        }
+        write_section(const write_section&) = delete;
+        write_section& operator = (const write_section&) = delete;
+    };
+
+    public:
+    // reserves n nodes, as list_pool does; max_readers is the number of threads that can pin epochs at once
+    explicit concurrent_list_pool(typename pool_type::size_type n = 0, std::size_t max_readers = 64)
+        : pool{},
+        padding0{},
+        sequence{ 0 },
+        padding1{},
+        epoch{ 0 },
+        padding2{},
+        slots{ new reader_slot[max_readers] },
+        max_readers{ max_readers },
+        limbo{},
+        retirements{ 0 }
+    {
+        for ( std::size_t i{0}; i < max_readers; ++i ) {
+            self.slots[i].epoch.store( idle );
+            self.slots[i].used.store( false );
+        }
+        self.pool.reserve( n );
+    }
+
+    // readers hold a reference to the pool, it can be neither copied nor moved
+    concurrent_list_pool(const concurrent_list_pool&) = delete;
+    concurrent_list_pool& operator = (const concurrent_list_pool&) = delete;
+
+
+    // ---- reader side, any number of threads ----
+
+    // returns the token to be validated at the end of the read; it spins while a write is in progress
+    Sequence read_begin() const noexcept {
+        while (true) {
+            Sequence current{ self.sequence.load(std::memory_order_acquire) };
+            if ( current % 2 == 0 ) {
+                return current;
+            }
+        }
+    }
+    // true if no write happened since read_begin() returned token, i.e., what was read is consistent.
+    // It can be called in the middle of a long traversal as well, for bailing out early.
+    bool read_validate(Sequence token) const noexcept {
+        std::atomic_thread_fence( std::memory_order_acquire );
+        return ( self.sequence.load(std::memory_order_relaxed) == token );
+    }
+
+    // runs f(const pool_type&) until it completes without a concurrent write and returns its result.
+    // f may be run several times, so it must not have side effects other than its result.
+    template <typename F>
+    auto read(F&& f) const -> decltype( f(std::declval<const pool_type&>()) ) {
+        while (true) {
+            Sequence token{ self.read_begin() };
+            auto result = f( static_cast<const pool_type&>(self.pool) );
+            if ( self.read_validate(token) ) {
+                return result;
+            }
+        }
+    }
+
+
+    // every thread that pins epochs needs a slot of its own, std::length_error is thrown when they are over
+    std::size_t register_reader() {
+        for ( std::size_t i{0}; i < self.max_readers; ++i ) {
+            bool expected{ false };
+            if ( self.slots[i].used.compare_exchange_strong(expected, true) ) {
+                return i;
+            }
+        }
+        throw std::length_error{ "too many readers registered to the pool" };
+    }
+    void unregister_reader(std::size_t reader) noexcept {
+        self.slots[ reader ].epoch.store( idle, std::memory_order_release );
+        self.slots[ reader ].used.store( false, std::memory_order_release );
+    }
+
+    // while an epoch_guard is alive, no node reachable by its reader is reused
+    class epoch_guard {
+        std::atomic<Epoch>* slot;
+
+        public:
+        epoch_guard(std::atomic<Epoch>* slot, Epoch current) noexcept
+            : slot{ slot }
+        {
+            (*slot).store( current, std::memory_order_seq_cst );
+        }
+        epoch_guard(epoch_guard&& other) noexcept
+            : slot{ other.slot }
+        {
+            other.slot = nullptr;
+        }
+        ~epoch_guard() {
+            if ( self.slot != nullptr ) {
+                (*self.slot).store( idle, std::memory_order_release );
+            }
+        }
+        epoch_guard(const epoch_guard&) = delete;
+        epoch_guard& operator = (const epoch_guard&) = delete;
+        epoch_guard& operator = (epoch_guard&&) = delete;
+    };
+    epoch_guard pin(std::size_t reader) const noexcept {
+        return epoch_guard{ &self.slots[ reader ].epoch, self.epoch.load(std::memory_order_seq_cst) };
+    }
+
+    // a pinned reader can traverse without validating
+    const pool_type& pinned_view(const epoch_guard&) const noexcept {
+        return self.pool;
+    }
+
+
+    // ---- writer side, a single thread ----
+
+    Index new_list() noexcept {
+        return self.pool.new_list();
+    }
+    void reserve(typename pool_type::size_type n) {
+        write_section section{ self };
+        self.pool.reserve( n );
+    }
+
+    Index push_front(const Value& value, Index head) {
+        write_section section{ self };
+        return self.pool.push_front( value, head );
+    }
+    Index push_front(Value&& value, Index head) {
+        write_section section{ self };
+        return self.pool.push_front( std::move(value), head );
+    }
+    Index push_back(const Value& value, Index head) {
+        write_section section{ self };
+        return self.pool.push_back( value, head );
+    }
+    Index push_back(Value&& value, Index head) {
+        write_section section{ self };
+        return self.pool.push_back( std::move(value), head );
+    }
+
+    // the node is only unlinked, its next is left untouched for the readers standing on it.
+    // As in list_pool::free(), an out-of-range head throws.
+    Index free(Index head) {
+        if ( self.pool.is_empty(head) ) {
+            return head;
+        }
+        Index next{ self.writer_view().next( head ) };
+        self.retire( retired{ head, true } );
+        return next;
+    }
+    Index free_list(Index head) {
+        if ( self.pool.is_empty(head) ) {
+            return head;
+        }
+        self.writer_view().next( head ); // just for the range check
+        self.retire( retired{ head, false } );
+        return self.pool.new_list();
+    }
+
+    // moves to the next epoch if every pinned reader is in the current one,
+    // and gives back to the pool the nodes retired in the previous epoch. Returns false if some reader lags behind.
+    bool try_reclaim() {
+        Epoch current{ self.epoch.load(std::memory_order_relaxed) };
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        for ( std::size_t i{0}; i < self.max_readers; ++i ) {
+            Epoch pinned{ self.slots[i].epoch.load(std::memory_order_seq_cst) };
+            if ( pinned != idle and pinned != current ) {
+                return false;
+            }
+        }
+        self.epoch.store( current + 1, std::memory_order_seq_cst );
+
+        // the readers are all in epoch current, they pinned it after the nodes retired in current - 1
+        // had been unlinked, so nobody can reach them anymore
+        std::vector<retired>& safe{ self.limbo[ (current + 2) % 3 ] };
+        if ( not safe.empty() ) {
+            write_section section{ self };
+            for ( const retired& run : safe ) {
+                if ( run.single ) {
+                    self.pool.next( run.first ) = self.pool.end();
+                }
+                self.pool.free_list( run.first );
+            }
+            safe.clear();
+        }
+        return true;
+    }
+
+    // number of runs (single nodes or whole lists) waiting to be reused
+    std::size_t in_limbo() const noexcept {
+        return self.limbo[0].size() + self.limbo[1].size() + self.limbo[2].size();
+    }
+
+    // any other mutation (e.g. assigning through value() or next()) goes through here:
+    // f(pool_type&) is run inside a write section. 
+    // Beware that list_pool::free() and list_pool::free_list() called from here bypass the limbo. 
+    template <typename F>
+    auto write(F&& f) -> decltype( f(std::declval<pool_type&>()) ) {
+        write_section section{ self };
+        return f( self.pool );
+    }
+
+    private:
+    void retire(retired run) {
+        self.limbo[ self.epoch.load(std::memory_order_relaxed) % 3 ].push_back( run );
+        if ( ++self.retirements % advance_period == 0 ) {
+            self.try_reclaim();
+        }
+    }
+
+    public:
+    // the writer does not race with itself, it can read without validation
+    const pool_type& writer_view() const noexcept {
+        return self.pool;
+    }
+};
+
+#undef self
+#endif // __concurrent_list_pool_header_guard__
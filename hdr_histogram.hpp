@@ -0,0 +1,103 @@
+#ifndef __hdr_histogram_header_guard__
+#define __hdr_histogram_header_guard__
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pool_observers.hpp" // pool_timestamp()
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+// A high-dynamic-range histogram, for latency percentiles: values below 128 have a bucket each,
+// above that every power of two is split into 64 linear buckets, so any value is recorded with
+// a relative error below 1/64 (about 1.6%) over the whole 64-bit range, in 30 KB.
+class hdr_histogram {
+    static constexpr unsigned sub_bits{ 7 };
+    static constexpr std::uint64_t linear{ std::uint64_t(1) << sub_bits }; // 128
+    static constexpr std::uint64_t half{ linear / 2 }; // 64
+    static constexpr std::size_t buckets{ linear + (64 - sub_bits) * half };
+
+    std::vector<std::uint64_t> counts;
+    std::uint64_t total;
+    std::uint64_t largest;
+
+    static std::size_t index(std::uint64_t value) noexcept {
+        if ( value < linear ) {
+            return std::size_t( value );
+        }
+        unsigned msb{ 63u - unsigned( __builtin_clzll(value) ) };
+        unsigned shift{ msb - (sub_bits - 1) }; // value >> shift is in [64, 128)
+        return std::size_t( linear + (shift - 1) * half + ( (value >> shift) - half ) );
+    }
+    // the largest value recorded in bucket i
+    static std::uint64_t highest(std::size_t i) noexcept {
+        if ( i < linear ) {
+            return std::uint64_t( i );
+        }
+        unsigned shift{ unsigned( (i - linear) / half ) + 1 };
+        std::uint64_t mantissa{ (i - linear) % half + half };
+        return ( (mantissa + 1) << shift ) - 1;
+    }
+
+    public:
+    hdr_histogram()
+        : counts( buckets, 0 ),
+        total{ 0 },
+        largest{ 0 }
+    {}
+
+    void record(std::uint64_t value) noexcept {
+        ++self.counts[ self.index( value ) ];
+        ++self.total;
+        if ( value > self.largest ) {
+            self.largest = value;
+        }
+    }
+    void reset() noexcept {
+        std::fill( self.counts.begin(), self.counts.end(), 0 );
+        self.total = 0;
+        self.largest = 0;
+    }
+
+    std::uint64_t count() const noexcept {
+        return self.total;
+    }
+    std::uint64_t max() const noexcept {
+        return self.largest;
+    }
+    // the value below which p percent of the recorded values are (0 < p <= 100), rounded up to its bucket
+    std::uint64_t percentile(double p) const noexcept {
+        std::uint64_t seen{ 0 };
+        for ( std::size_t i{0}; i < buckets; ++i ) {
+            seen += self.counts[i];
+            if ( self.total > 0 and double(seen) >= p / 100.0 * double(self.total) ) {
+                return std::min( self.highest( i ), self.largest );
+            }
+        }
+        return self.largest;
+    }
+};
+
+
+// nanoseconds per pool_timestamp() tick, measured once against the steady clock
+inline double ns_per_tick() {
+    static const double ratio{ [] {
+        auto start = std::chrono::steady_clock::now();
+        std::uint64_t first{ pool_timestamp() };
+        while ( std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20) ) {
+        }
+        std::uint64_t ticks{ pool_timestamp() - first };
+        double ns{ std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count() };
+        return ticks == 0 ? 1.0 : ns / double(ticks);
+    }() };
+    return ratio;
+}
+
+#undef self
+#endif // __hdr_histogram_header_guard__
@@ -0,0 +1,202 @@
+#ifndef __link_pool_header_guard__
+#define __link_pool_header_guard__
+
+#include "list_pool.hpp"
+
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+// list_pool without the values: a pool of next links only, sizeof(Index) per element, for values that
+// already live in a table of their own (a column, a std::vector, a memory-mapped array...).
+// The pool hands out slots exactly like list_pool hands out nodes (free_node_list, free(), free_list()),
+// and the value of slot index lives at position(index), i.e. index - 1, in the caller's table, which must
+// be kept at least size() long. push_front() and push_back() only link the slot: the caller writes the value.
+// The iterators take the table and dereference into it, so any random-access container will do.
+template <typename Index = std::size_t, template <typename> class Storage = vector_storage>
+class link_pool {
+    static_assert( std::is_unsigned<Index>::value, "indices are unsigned" );
+
+    public:
+    using list_type = Index;
+    using size_type = typename Storage<Index>::size_type;
+
+    private:
+    Storage<Index> links; // the next of slot i is links[i - 1]
+    Index free_node_list;
+
+    Index& link(Index index) { return self.links[ index - 1 ]; }
+    const Index& link(Index index) const { return self.links[ index - 1 ]; }
+
+    void check_index(Index index) const {
+        if ( index > self.links.size() ) {
+            throw std::invalid_argument{ "the value of the provided index is invalid, too big" };
+        }
+    }
+
+    Index allocate(Index next) {
+        if ( self.is_empty( self.free_node_list ) ) {
+            if ( self.links.size() >= size_type( std::numeric_limits<Index>::max() ) ) {
+                throw std::overflow_error{ "the indices of the pool are exhausted" };
+            }
+            self.links.emplace_back( next );
+            return Index( self.links.size() );
+        }
+        Index index{ self.free_node_list };
+        self.free_node_list = self.link( index );
+        self.link( index ) = next;
+        return index;
+    }
+
+    Index get_tail(Index index) const {
+        while ( not self.is_empty( self.link( index ) ) ) {
+            index = self.link( index );
+        }
+        return index;
+    }
+
+    public:
+    // a forward iterator over the values of a list, read from the caller's table
+    template <typename Values>
+    class iterator {
+        friend link_pool;
+
+        const link_pool* owner;
+        Values* values;
+        Index current;
+
+        iterator(const link_pool* owner, Values* values, Index current) noexcept
+            : owner{ owner },
+            values{ values },
+            current{ current }
+        {}
+
+        public:
+        using reference = decltype( std::declval<Values&>()[0] );
+        using value_type = typename std::decay<reference>::type;
+        using pointer = typename std::remove_reference<reference>::type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        reference operator * () const {
+            return (*self.values)[ position( self.current ) ];
+        }
+        pointer operator -> () const {
+            return &**this;
+        }
+        // the slot under the iterator
+        Index index() const noexcept {
+            return self.current;
+        }
+        iterator& operator ++ () {
+            self.current = (*self.owner).next( self.current );
+            return self;
+        }
+        iterator operator ++ (int) {
+            iterator old{ self };
+            ++self;
+            return old;
+        }
+        bool operator == (const iterator& other) const noexcept {
+            return self.current == other.current;
+        }
+        bool operator != (const iterator& other) const noexcept {
+            return not ( self == other );
+        }
+    };
+
+    link_pool() : links{}, free_node_list{ self.new_list() } {}
+    explicit link_pool(size_type n) : link_pool() {
+        self.reserve( n );
+    }
+
+    Index new_list() const noexcept {
+        return Index( 0 );
+    }
+    Index end() const noexcept {
+        return Index( 0 );
+    }
+    bool is_empty(Index head) const noexcept {
+        return head == Index( 0 );
+    }
+    // where the value of a slot lives in the caller's table
+    static std::size_t position(Index index) noexcept {
+        return std::size_t( index ) - 1;
+    }
+
+    // a slot linked in front of head: the new head, whose value is to be written at position(head)
+    Index push_front(Index head) {
+        self.check_index( head );
+        return self.allocate( head );
+    }
+    // a slot linked after the tail of head, O(length); returns the head, which is the new slot if head was empty
+    Index push_back(Index head) {
+        self.check_index( head );
+        Index index{ self.allocate( self.end() ) };
+        if ( self.is_empty( head ) ) {
+            return index;
+        }
+        self.link( self.get_tail( head ) ) = index;
+        return head;
+    }
+    // the first slot goes back to the free list, returns the new head
+    Index free(Index head) {
+        if ( self.is_empty( head ) ) {
+            return head;
+        }
+        self.check_index( head );
+        Index next{ self.link( head ) };
+        self.link( head ) = self.free_node_list;
+        self.free_node_list = head;
+        return next;
+    }
+    // the whole list is spliced in front of the free list
+    Index free_list(Index head) {
+        if ( self.is_empty( head ) ) {
+            return head;
+        }
+        self.check_index( head );
+        self.link( self.get_tail( head ) ) = self.free_node_list;
+        self.free_node_list = head;
+        return self.new_list();
+    }
+
+    Index next(Index index) const {
+        if ( self.is_empty( index ) ) {
+            throw std::invalid_argument{ "the list should not be empty" };
+        }
+        self.check_index( index );
+        return self.link( index );
+    }
+
+    template <typename Values>
+    iterator<Values> begin(Index head, Values& values) const noexcept {
+        return iterator<Values>{ &self, &values, head };
+    }
+    template <typename Values>
+    iterator<Values> end(Index, Values& values) const noexcept {
+        return iterator<Values>{ &self, &values, self.end() };
+    }
+
+    void reserve(size_type n) {
+        self.links.reserve( n );
+    }
+    // the slots handed out so far: the caller's table must be at least this long
+    size_type size() const noexcept {
+        return self.links.size();
+    }
+    size_type capacity() const noexcept {
+        return self.links.capacity();
+    }
+};
+
+#undef self
+#endif // __link_pool_header_guard__
@@ -1,42 +1,341 @@
 #ifndef __list_pool_header_guard__
 #define __list_pool_header_guard__
 
+#include <algorithm>
+#include <bitset>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <limits>
+#include <thread>
 #include <vector>
 #include <stdexcept>
+#include <string>
 #include <iterator>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 
 // I know that this is not Python, nor Rust, but I like self (explicit) and find '->' to be very ugly
 #define self (*this)
 
-// a simple macro for stripping the constness from (this), it lets me call a non-const method from a const method. 
-// I know it is not reccomended but it comes handy for avoiding code duplication, 
-// e.g., for list_pool::value() and list_pool::next()
-#define $deconst(type) ( *(const_cast<type*>(this)) )
+// Optional USDT (user-level statically defined tracing) probes, for bpftrace & co.: build with -DLIST_POOL_USDT 
+// (it needs sys/sdt.h, e.g. from systemtap-sdt-dev). A disabled probe costs a nop in the binary, 
+// without LIST_POOL_USDT the probes are not there at all. The provider is list_pool, the probes are 
+//   alloc_fresh(index), alloc_recycled(index), free(index), free_list(head, nodes), 
+//   growth(old capacity, new capacity, bytes moved), compact(nodes in the lists, nodes in the pool), 
+//   collect(nodes reclaimed) 
+// e.g.  bpftrace -e 'usdt:./tests.x:list_pool:growth { @moved = sum(arg2); }' 
+#ifdef LIST_POOL_USDT
+#include <sys/sdt.h>
+#define LIST_POOL_PROBE1(name, a) DTRACE_PROBE1(list_pool, name, a)
+#define LIST_POOL_PROBE2(name, a, b) DTRACE_PROBE2(list_pool, name, a, b)
+#define LIST_POOL_PROBE3(name, a, b, c) DTRACE_PROBE3(list_pool, name, a, b, c)
+#else
+#define LIST_POOL_PROBE1(name, a) ((void) 0)
+#define LIST_POOL_PROBE2(name, a, b) ((void) 0)
+#define LIST_POOL_PROBE3(name, a, b, c) ((void) 0)
+#endif
 
+// a vector-like container that stores its elements in fixed-size chunks of 2^ChunkBits elements. 
+// Unlike std::vector, growing it never moves the elements already stored: a node keeps its address 
+// for the whole lifetime of the container. This is what makes optimistic (lock-free) readers possible, 
+// a reader racing with emplace_back() can never end up reading a node from a freed buffer. 
+// For the same reason the table of chunks is never freed while the container is alive: when it must grow, 
+// the old table is retired and kept around (the retired tables sum up to less than the live one). 
+//
+// Chunks are reference counted and copy-on-write: a copy just shares the chunks of the original, 
+// so it costs O(#chunks), and a chunk is cloned only the first time it is accessed for writing 
+// (i.e., through the non-const operator [] or emplace_back()) while it is shared. 
+// Every writing access also marks its chunk as dirty, which is what list_pool::checkpoint_delta() relies on. 
+template <typename T, std::size_t ChunkBits = 12>
+class chunked_vector {
+    public: 
+    using size_type = std::size_t; 
+    using value_type = T; 
+    static constexpr size_type chunk_size = size_type(1) << ChunkBits; 
+
+    private: 
+    static constexpr size_type mask = chunk_size - 1; 
+
+    using Slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type; 
+    struct Chunk {
+        std::atomic<size_type> refs; // number of containers sharing the chunk
+        size_type count; // number of constructed elements
+        Slot slots[chunk_size]; 
+    }; 
+
+    std::vector<std::unique_ptr<Chunk*[]>> tables; // tables.back() is the live one, the others are retired
+    std::atomic<Chunk**> table; // the live table, published to the readers
+    size_type table_capacity; 
+    size_type chunks; // number of allocated chunks 
+    std::atomic<size_type> count; // number of constructed elements
+    std::vector<bool> dirty; // chunks written since the last clear_dirty()
+
+    Chunk& chunk(size_type c) const noexcept {
+        return *( self.table.load(std::memory_order_acquire)[c] ); 
+    }
+
+    static Chunk* new_chunk() {
+        Chunk* chunk{ new Chunk }; 
+        chunk->refs.store( 1, std::memory_order_relaxed ); 
+        chunk->count = 0; 
+        return chunk; 
+    }
+    // the last container letting go of a chunk destroys it
+    static void release(Chunk* chunk) noexcept {
+        if ( chunk->refs.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+            for ( size_type i{0}; i < chunk->count; ++i ) {
+                reinterpret_cast<T*>( &chunk->slots[i] )->~T(); 
+            }
+            delete chunk; 
+        }
+    }
+
+    // the chunk c, cloned first if it is shared with a copy
+    Chunk& writable_chunk(size_type c) {
+        self.dirty[c] = true; 
+        return self.unshared_chunk( c ); 
+    }
+    Chunk& unshared_chunk(size_type c) {
+        Chunk*& chunk{ self.tables.back()[c] }; 
+        if ( chunk->refs.load(std::memory_order_acquire) != 1 ) {
+            Chunk* clone{ self.new_chunk() }; 
+            try {
+                for ( ; clone->count < chunk->count; ++clone->count ) {
+                    const T& original{ *reinterpret_cast<const T*>( &chunk->slots[ clone->count ] ) }; 
+                    ::new ( static_cast<void*>(&clone->slots[ clone->count ]) ) T( original ); 
+                }
+            } catch (...) {
+                self.release( clone ); 
+                throw; 
+            }
+            self.release( chunk ); 
+            chunk = clone; 
+        }
+        return *chunk; 
+    }
+
+    // makes room in the table for n chunks
+    void grow_table(size_type n) {
+        if ( n > self.table_capacity ) {
+            size_type capacity{ std::max( std::max(2 * self.table_capacity, n), size_type(8) ) }; 
+            std::unique_ptr<Chunk*[]> bigger{ new Chunk*[capacity] }; 
+            for ( size_type c{0}; c < self.chunks; ++c ) {
+                bigger[c] = self.tables.back()[c]; 
+            }
+            self.tables.push_back( std::move(bigger) ); 
+            self.table_capacity = capacity; 
+            self.table.store( self.tables.back().get(), std::memory_order_release ); 
+        }
+    }
+    // allocates (without constructing anything) as many chunks as needed to have n of them
+    void grow_chunks(size_type n) {
+        if ( n <= self.chunks ) {
+            return; // there might not even be a table yet
+        }
+        self.grow_table( n ); 
+        self.dirty.resize( std::max(n, self.chunks), false ); 
+        Chunk** live{ self.tables.back().get() }; 
+        for ( ; self.chunks < n; ++self.chunks ) {
+            live[ self.chunks ] = self.new_chunk(); 
+        }
+    }
+
+    public: 
+    chunked_vector() noexcept 
+        : tables{}, 
+        table{ nullptr }, 
+        table_capacity{ 0 }, 
+        chunks{ 0 }, 
+        count{ 0 }, 
+        dirty{}
+    {}
+    // the copy shares all the chunks, nothing is copied until someone writes
+    chunked_vector(const chunked_vector& other) : chunked_vector() {
+        if ( other.chunks == 0 ) {
+            return; 
+        }
+        self.grow_table( other.chunks ); 
+        self.dirty = other.dirty; 
+        Chunk** live{ self.tables.back().get() }; 
+        for ( ; self.chunks < other.chunks; ++self.chunks ) {
+            live[ self.chunks ] = other.tables.back()[ self.chunks ]; 
+            live[ self.chunks ]->refs.fetch_add( 1, std::memory_order_relaxed ); 
+        }
+        self.count.store( other.size(), std::memory_order_release ); 
+    }
+    chunked_vector(chunked_vector&& other) noexcept : chunked_vector() {
+        self.swap( other ); 
+    }
+    chunked_vector& operator = (chunked_vector rhs) noexcept {
+        self.swap( rhs ); 
+        return self; 
+    }
+    ~chunked_vector() { 
+        for ( size_type c{0}; c < self.chunks; ++c ) {
+            self.release( self.tables.back()[c] ); 
+        }
+    }
+
+    void swap(chunked_vector& other) noexcept {
+        std::swap( self.tables, other.tables ); 
+        std::swap( self.table_capacity, other.table_capacity ); 
+        std::swap( self.chunks, other.chunks ); 
+        std::swap( self.dirty, other.dirty ); 
+        Chunk** table{ self.table.load() }; 
+        self.table.store( other.table.load() ); 
+        other.table.store( table ); 
+        size_type count{ self.count.load() }; 
+        self.count.store( other.count.load() ); 
+        other.count.store( count ); 
+    }
+
+    // writing access: it might have to clone a shared chunk, hence it might throw
+    T& operator [] (size_type i) {
+        return *reinterpret_cast<T*>( &self.writable_chunk( i >> ChunkBits ).slots[ i & mask ] ); 
+    }
+    const T& operator [] (size_type i) const noexcept {
+        return *reinterpret_cast<const T*>( &self.chunk( i >> ChunkBits ).slots[ i & mask ] ); 
+    }
+
+    // the element is fully constructed before the new size is published, 
+    // so a reader that sees the new size also sees the new element
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        size_type n{ self.count.load(std::memory_order_relaxed) }; 
+        if ( (n >> ChunkBits) == self.chunks ) {
+            self.grow_chunks( self.chunks + 1 ); 
+        }
+        Chunk& chunk{ self.writable_chunk( n >> ChunkBits ) }; 
+        ::new ( static_cast<void*>(&chunk.slots[ n & mask ]) ) T( std::forward<Args>(args)... ); 
+        ++chunk.count; 
+        self.count.store( n + 1, std::memory_order_release ); 
+    }
+
+    void reserve(size_type n) {
+        self.grow_chunks( (n + mask) >> ChunkBits ); 
+    }
+    size_type size() const noexcept {
+        return self.count.load(std::memory_order_acquire); 
+    }
+    size_type capacity() const noexcept {
+        return self.chunks * chunk_size; 
+    }
+    // chunk-wise access, for writing the elements out in big blocks
+    size_type chunk_count() const noexcept {
+        return self.chunks; 
+    }
+    const T* chunk_data(size_type c) const noexcept {
+        return reinterpret_cast<const T*>( &self.chunk( c ).slots[0] ); 
+    }
+    size_type chunk_elements(size_type c) const noexcept {
+        return self.chunk( c ).count; 
+    }
+
+    // clones every chunk shared with a copy, afterwards writing cannot throw until the next copy
+    void unshare() {
+        for ( size_type c{0}; c < self.chunks; ++c ) {
+            self.unshared_chunk( c ); 
+        }
+    }
+
+    bool is_dirty(size_type c) const noexcept {
+        return self.dirty[c]; 
+    }
+    void clear_dirty() noexcept {
+        std::fill( self.dirty.begin(), self.dirty.end(), false ); 
+    }
+
+    // number of chunks shared with some copy, mostly for testing the copy-on-write
+    size_type shared_chunks() const noexcept {
+        size_type shared{ 0 }; 
+        for ( size_type c{0}; c < self.chunks; ++c ) {
+            shared += ( self.tables.back()[c]->refs.load(std::memory_order_relaxed) != 1 ); 
+        }
+        return shared; 
+    }
+}; 
+
+
+// list_pool takes its storage as a template template parameter, any vector-like class template with 
+// size(), capacity(), reserve(), emplace_back() and operator [] will do. 
+// std::vector itself has two template parameters (the allocator), hence the alias. 
+template <typename T>
+using vector_storage = std::vector<T>; 
+
+template <typename T>
+using chunked_storage = chunked_vector<T>; 
+
+// tag for the list_pool constructor forwarding its arguments to the storage, 
+// for storages that need some (e.g. shm_storage in shm_storage.hpp)
+struct storage_args_t {
+    explicit storage_args_t() = default; 
+}; 
+constexpr storage_args_t storage_args{}; 
+
+
+// The hook for memory accounting (list_pool::memory_usage() and memory_report()): the bytes a value owns 
+// on the heap, beyond its own sizeof. Nothing by default, strings and vectors count their buffers 
+// (not what their elements own in turn). Specialize it for your own types, or pass any callable to the methods. 
+template <typename Value>
+struct value_heap_bytes {
+    std::size_t operator () (const Value&) const noexcept { return 0; }
+}; 
+template <typename Char, typename Traits, typename Allocator>
+struct value_heap_bytes<std::basic_string<Char, Traits, Allocator>> {
+    std::size_t operator () (const std::basic_string<Char, Traits, Allocator>& s) const noexcept {
+        // short strings live inside the object itself
+        static const std::size_t inline_capacity{ std::basic_string<Char, Traits, Allocator>{}.capacity() }; 
+        return s.capacity() > inline_capacity ? ( s.capacity() + 1 ) * sizeof(Char) : 0; 
+    }
+}; 
+template <typename T, typename Allocator>
+struct value_heap_bytes<std::vector<T, Allocator>> {
+    std::size_t operator () (const std::vector<T, Allocator>& v) const noexcept {
+        return v.capacity() * sizeof(T); 
+    }
+}; 
+
+// where the memory of a pool goes, see list_pool::memory_report()
+struct pool_memory {
+    std::size_t live_nodes; // in some list
+    std::size_t free_nodes; // in free_node_list
+    std::size_t reserved_nodes; // capacity() - size(), not constructed yet
+    std::size_t live_bytes; // the live nodes and what their values own
+    std::size_t free_bytes; // the free nodes and what their stale values still own
+    std::size_t reserved_bytes; 
+
+    std::size_t total_bytes() const noexcept {
+        return live_bytes + free_bytes + reserved_bytes; 
+    }
+}; 
 
-// class declaration needed for telling list_pool_iterator::Iter about its friend class list_pool;  
-// This way the iterator's constructor can be made private and only list_pool objects are allowed to 
-// create them and modify their state 
-template <typename Value, typename Index>
-class list_pool; 
 
 // I create a namespace for the iterator so I have to type list_pool_iterator only once and 
 // I can call the iterator itself simply Iter
 namespace list_pool_iterator {
     // all the methods of the class are marked noexcept because we control the state 
     // of the iterator and we know that nothing bad can happen 
+    // the pool owning the iterator (whatever its storage) is its only friend, 
+    // this way the constructor can be made private and only the pool can create iterators and modify their state 
     template <typename Pool, typename Value, typename Index> 
     class Iter {
-        friend class list_pool<Value, Index>; 
+        friend typename std::remove_const<Pool>::type; 
 
         Pool* pool; 
         Index current; 
 
+        // moving on only reads, even through a non-const iterator (a copy-on-write storage is not written) 
         void update() noexcept {
             if ( self.current != Index(0) ) {
-                self.current = (*self.pool).node( self.current ).next; 
+                self.current = static_cast<const Pool&>( *self.pool ).node( self.current ).next; 
             }
         }
         Value& value() noexcept {
@@ -51,9 +350,10 @@ namespace list_pool_iterator {
         {}
 
         public: 
-        using value_type = Value;
-        using reference = value_type&;
-        using pointer = value_type*;
+        using value_type = typename std::remove_const<Value>::type;
+        using reference = Value&;
+        using pointer = Value*;
+        using difference_type = std::ptrdiff_t;
         using iterator_category = std::forward_iterator_tag;
 
 
@@ -89,8 +389,271 @@ namespace list_pool_iterator {
 }
 
 
-template <typename Value, typename Index = std::size_t>
-class list_pool {
+// helpers for the compressed format of list_pool (save_compressed() and load_compressed()): 
+// integers are written as varints (7 bits per byte, the high bit flags that more bytes follow) 
+// and the signed ones are zigzag-encoded first, so that small negative numbers are short too. 
+// The links go by blocks of bit-packed integers, all of a block at the same width: unpacking is a loop 
+// without branches over a buffer read in one go. 
+// A value codec is any class with encode(std::streambuf&, const Value&) and decode<Value>(std::streambuf&); 
+// it may also have encode_block(std::streambuf&, const Value*, n) and decode_block(std::streambuf&, Value*, n), 
+// which are then used instead for the values of a whole block. 
+namespace list_pool_codec {
+    inline void put_byte(std::streambuf& out, unsigned char byte) {
+        if ( std::streambuf::traits_type::eq_int_type( out.sputc( char(byte) ), std::streambuf::traits_type::eof() ) ) {
+            throw std::runtime_error{ "error while writing the pool" }; 
+        }
+    }
+    inline unsigned char get_byte(std::streambuf& in) {
+        std::streambuf::int_type byte{ in.sbumpc() }; 
+        if ( std::streambuf::traits_type::eq_int_type( byte, std::streambuf::traits_type::eof() ) ) {
+            throw std::runtime_error{ "the compressed pool is truncated" }; 
+        }
+        return static_cast<unsigned char>( byte ); 
+    }
+
+    inline void put_varint(std::streambuf& out, std::uint64_t x) {
+        while ( x >= 0x80 ) {
+            put_byte( out, static_cast<unsigned char>(x | 0x80) ); 
+            x >>= 7; 
+        }
+        put_byte( out, static_cast<unsigned char>(x) ); 
+    }
+    inline std::uint64_t get_varint(std::streambuf& in) {
+        std::uint64_t x{ 0 }; 
+        for ( unsigned shift{0}; shift < 64; shift += 7 ) {
+            unsigned char byte{ get_byte( in ) }; 
+            x |= std::uint64_t(byte & 0x7f) << shift; 
+            if ( (byte & 0x80) == 0 ) {
+                return x; 
+            }
+        }
+        throw std::runtime_error{ "the compressed pool is corrupted, varint too long" }; 
+    }
+
+    inline void put_bytes(std::streambuf& out, const void* bytes, std::size_t n) {
+        if ( out.sputn( static_cast<const char*>(bytes), std::streamsize(n) ) != std::streamsize(n) ) {
+            throw std::runtime_error{ "error while writing the pool" }; 
+        }
+    }
+    inline void get_bytes(std::streambuf& in, void* bytes, std::size_t n) {
+        if ( in.sgetn( static_cast<char*>(bytes), std::streamsize(n) ) != std::streamsize(n) ) {
+            throw std::runtime_error{ "the compressed pool is truncated" }; 
+        }
+    }
+
+    // n integers, bit-packed (frame of reference): a byte for the width, then n * width bits in 64-bit words, 
+    // in the byte order of the machine (like the raw format), then the exceptions, the integers too wide for 
+    // the packing: their count, and for each one its position and its value (varints). 
+    // The width is the one that makes the block the smallest, a few outliers (e.g. the jump from a list 
+    // to the next one) do not widen all the others. 
+    inline void pack(std::streambuf& out, const std::uint64_t* x, std::size_t n, std::vector<std::uint64_t>& words) {
+        std::size_t at_width[65]{}; // the integers needing exactly that many bits
+        for ( std::size_t i{0}; i < n; ++i ) {
+            unsigned bits{ 0 }; 
+            for ( ; bits < 64 and ( x[i] >> bits ) != 0; ++bits ) {}
+            ++at_width[ bits ]; 
+        }
+        // an exception costs about 3 bytes, whichever width is chosen
+        unsigned width{ 64 }; 
+        std::size_t best{ n * 64 }, exceptions{ 0 }, wider{ 0 }; 
+        for ( unsigned w{ 64 }; w-- > 0; ) {
+            wider += at_width[ w + 1 ]; 
+            if ( n * w + wider * 24 <= best ) {
+                best = n * w + wider * 24; 
+                width = w; 
+                exceptions = wider; 
+            }
+        }
+        const std::uint64_t mask{ width == 64 ? ~std::uint64_t(0) : ( std::uint64_t(1) << width ) - 1 }; 
+        put_byte( out, static_cast<unsigned char>(width) ); 
+        words.assign( ( n * width + 63 ) / 64 + 1, 0 ); 
+        for ( std::size_t i{0}; i < n; ++i ) {
+            std::size_t bit{ i * width }, offset{ bit % 64 }; 
+            words[ bit / 64 ] |= ( x[i] & mask ) << offset; 
+            if ( offset + width > 64 ) {
+                words[ bit / 64 + 1 ] |= ( x[i] & mask ) >> ( 64 - offset ); 
+            }
+        }
+        put_bytes( out, words.data(), ( n * width + 63 ) / 64 * 8 ); 
+        put_varint( out, exceptions ); 
+        for ( std::size_t i{0}; i < n and exceptions > 0; ++i ) {
+            if ( x[i] > mask ) {
+                put_varint( out, i ); 
+                put_varint( out, x[i] ); 
+                --exceptions; 
+            }
+        }
+    }
+    inline void unpack(std::streambuf& in, std::uint64_t* x, std::size_t n, std::vector<std::uint64_t>& words) {
+        unsigned width{ get_byte( in ) }; 
+        if ( width > 64 ) {
+            throw std::runtime_error{ "the compressed pool is corrupted, invalid width" }; 
+        }
+        words.assign( ( n * width + 63 ) / 64 + 1, 0 ); // a word of padding, read but masked out
+        get_bytes( in, words.data(), ( n * width + 63 ) / 64 * 8 ); 
+        const std::uint64_t mask{ width == 64 ? ~std::uint64_t(0) : ( std::uint64_t(1) << width ) - 1 }; 
+        for ( std::size_t i{0}; i < n; ++i ) {
+            std::size_t bit{ i * width }, offset{ bit % 64 }; 
+            // the high part is shifted in two steps, a shift by 64 would be undefined
+            x[i] = ( ( words[ bit / 64 ] >> offset ) | ( ( words[ bit / 64 + 1 ] << 1 ) << ( 63 - offset ) ) ) & mask; 
+        }
+        std::uint64_t exceptions{ get_varint( in ) }; 
+        if ( exceptions > n ) {
+            throw std::runtime_error{ "the compressed pool is corrupted, too many exceptions" }; 
+        }
+        for ( ; exceptions > 0; --exceptions ) {
+            std::uint64_t i{ get_varint( in ) }; 
+            if ( i >= n ) {
+                throw std::runtime_error{ "the compressed pool is corrupted, invalid exception" }; 
+            }
+            x[i] = get_varint( in ); 
+        }
+    }
+
+    inline std::uint64_t zigzag(std::int64_t x) noexcept {
+        return ( std::uint64_t(x) << 1 ) ^ std::uint64_t( x >> 63 ); 
+    }
+    inline std::int64_t unzigzag(std::uint64_t x) noexcept {
+        return std::int64_t( x >> 1 ) ^ -std::int64_t( x & 1 ); 
+    }
+
+    // the values as they are in memory, for any trivially copyable type
+    struct raw {
+        template <typename Value>
+        void encode(std::streambuf& out, const Value& value) const {
+            static_assert( std::is_trivially_copyable<Value>::value, "raw values must be trivially copyable" ); 
+            if ( out.sputn( reinterpret_cast<const char*>(&value), sizeof(Value) ) != std::streamsize(sizeof(Value)) ) {
+                throw std::runtime_error{ "error while writing the pool" }; 
+            }
+        }
+        template <typename Value>
+        Value decode(std::streambuf& in) const {
+            static_assert( std::is_trivially_copyable<Value>::value, "raw values must be trivially copyable" ); 
+            typename std::aligned_storage<sizeof(Value), alignof(Value)>::type bytes; 
+            if ( in.sgetn( reinterpret_cast<char*>(&bytes), sizeof(Value) ) != std::streamsize(sizeof(Value)) ) {
+                throw std::runtime_error{ "the compressed pool is truncated" }; 
+            }
+            return *reinterpret_cast<const Value*>( &bytes ); 
+        }
+        template <typename Value>
+        void encode_block(std::streambuf& out, const Value* values, std::size_t n) const {
+            static_assert( std::is_trivially_copyable<Value>::value, "raw values must be trivially copyable" ); 
+            put_bytes( out, values, n * sizeof(Value) ); 
+        }
+        template <typename Value>
+        void decode_block(std::streambuf& in, Value* values, std::size_t n) const {
+            static_assert( std::is_trivially_copyable<Value>::value, "raw values must be trivially copyable" ); 
+            get_bytes( in, values, n * sizeof(Value) ); 
+        }
+    }; 
+
+    // integers as (zigzag) varints, small values take a single byte
+    struct varint {
+        template <typename Value>
+        void encode(std::streambuf& out, const Value& value) const {
+            static_assert( std::is_integral<Value>::value, "varint values must be integers" ); 
+            put_varint( out, std::is_signed<Value>::value ? zigzag( std::int64_t(value) ) : std::uint64_t(value) ); 
+        }
+        template <typename Value>
+        Value decode(std::streambuf& in) const {
+            static_assert( std::is_integral<Value>::value, "varint values must be integers" ); 
+            std::uint64_t x{ get_varint( in ) }; 
+            return std::is_signed<Value>::value ? Value( unzigzag(x) ) : Value( x ); 
+        }
+    }; 
+
+    // the values of a block, through encode_block()/decode_block() when the codec has them 
+    // (the int argument picks these overloads first), one at a time otherwise
+    template <typename Codec, typename Value>
+    auto encode_values(const Codec& codec, std::streambuf& out, const Value* values, std::size_t n, int) 
+            -> decltype( codec.encode_block( out, values, n ) ) {
+        return codec.encode_block( out, values, n ); 
+    }
+    template <typename Codec, typename Value>
+    void encode_values(const Codec& codec, std::streambuf& out, const Value* values, std::size_t n, long) {
+        for ( std::size_t i{0}; i < n; ++i ) {
+            codec.encode( out, values[i] ); 
+        }
+    }
+    template <typename Codec, typename Value>
+    auto decode_values(const Codec& codec, std::streambuf& in, Value* values, std::size_t n, int) 
+            -> decltype( codec.decode_block( in, values, n ) ) {
+        return codec.decode_block( in, values, n ); 
+    }
+    template <typename Codec, typename Value>
+    void decode_values(const Codec& codec, std::streambuf& in, Value* values, std::size_t n, long) {
+        for ( std::size_t i{0}; i < n; ++i ) {
+            values[i] = codec.template decode<Value>( in ); 
+        }
+    }
+}
+
+
+// the default logging policy of list_pool: it does nothing and it compiles to nothing. 
+// A policy is told about every mutation before it becomes visible (see write_ahead_log in operation_log.hpp): 
+// a push has allocated its node but not linked it yet, a free has not unlinked anything. If the policy throws, 
+// the operation does not happen (the node of a push goes back to free_node_list) and the exception propagates. 
+struct no_log {
+    template <typename Value, typename Index>
+    void push_front(const Value&, Index) noexcept {}
+    template <typename Value, typename Index>
+    void push_back(const Value&, Index) noexcept {}
+    template <typename Index>
+    void free(Index) noexcept {}
+    template <typename Index>
+    void free_list(Index) noexcept {}
+}; 
+
+
+// the operations timed by an observer
+enum class pool_op { push_front, push_back, free, free_list }; 
+
+// The default instrumentation policy of list_pool: no hook does anything and everything compiles to nothing. 
+// An observer is told about node allocations (brand new or recycled from free_node_list), frees, growths 
+// of the storage, about how many nodes get_tail() walks (for push_back and free_list) and about the traversals 
+// (on_traverse(head), from the non-const list_pool::begin(head)). begin() and end() bracket every pool_op, for timing them: end() gets the token returned by begin(). 
+// Hooks must not throw. They are called only from the non-const methods, never from a const one: the observer 
+// belongs to the single thread that may mutate the pool and needs no synchronization, while readers sharing 
+// a const pool (cbegin(), value() const...) never touch it, and are not observed. 
+// See pool_observers.hpp for some ready-made observers. 
+struct no_observer {
+    struct token {}; 
+
+    void on_allocate_fresh(std::size_t) noexcept {}
+    void on_allocate_recycled(std::size_t) noexcept {}
+    void on_free(std::size_t) noexcept {}
+    void on_free_list(std::size_t) noexcept {}
+    void on_growth(std::size_t, std::size_t) noexcept {}
+    void on_tail_walk(std::size_t) noexcept {}
+    void on_traverse(std::size_t) noexcept {}
+
+    token begin(pool_op) noexcept { return token{}; }
+    void end(pool_op, token) noexcept {}
+}; 
+
+
+// list_pool holds its logging and instrumentation policies through policy_holder: a stateless one 
+// (no_log, no_observer) becomes an empty base and takes no room, the pool stays as big as its storage 
+// and free_node_list. Tag tells apart two policies of the same type. 
+template <typename Policy, int Tag, bool = std::is_empty<Policy>::value and not std::is_final<Policy>::value>
+class policy_holder {
+    Policy policy; 
+
+    public:
+    Policy& get() noexcept { return self.policy; }
+    const Policy& get() const noexcept { return self.policy; }
+}; 
+template <typename Policy, int Tag>
+class policy_holder<Policy, Tag, true> : private Policy {
+    public:
+    Policy& get() noexcept { return self; }
+    const Policy& get() const noexcept { return self; }
+}; 
+
+
+template <typename Value, typename Index = std::size_t, template <typename> class Storage = vector_storage, 
+        typename Log = no_log, typename Observer = no_observer>
+class list_pool : private policy_holder<Log, 0>, private policy_holder<Observer, 1> {
     struct Node{
         Value value;
         Index next;
@@ -112,33 +675,441 @@ class list_pool {
         Node& operator = (Node&&) noexcept = default; 
     };
     
-    using Size = typename std::vector<Node>::size_type;
+    using Size = typename Storage<Node>::size_type;
 
-    std::vector<Node> pool;
+    Storage<Node> pool;
     Index free_node_list; // at the beginning, it is empty
 
+    Log& logger() noexcept { return self.policy_holder<Log, 0>::get(); }
+    Observer& hooks() noexcept { return self.policy_holder<Observer, 1>::get(); }
+    const Observer& hooks() const noexcept { return self.policy_holder<Observer, 1>::get(); }
+
     // of course we must ensure that 0 < index <= pool.size(). 
     // check_index1() and check_index2() will perform this check and throw an exception 
     // when the check fails. 
-    Node& node(Index index) noexcept { return self.pool[ index - 1 ]; }
+    // The non-const version is noexcept unless the storage is copy-on-write (it might have to clone a chunk).
+    Node& node(Index index) noexcept( noexcept(std::declval<Storage<Node>&>()[0]) ) { return self.pool[ index - 1 ]; }
     const Node& node(Index index) const noexcept { return self.pool[ index - 1 ]; }
 
 
     public:
+    using value_type = Value; 
+    using list_type = Index; 
+    using size_type = Size; 
+
     list_pool() 
-        : pool{ std::vector<Node>() }, 
+        : policy_holder<Log, 0>{}, 
+        policy_holder<Observer, 1>{}, 
+        pool{}, 
         free_node_list{ self.new_list() }
     {}
     explicit list_pool(Size n) : list_pool() { // reserve n nodes in the pool
         self.reserve( n ); 
     } 
+    template <typename... Args>
+    explicit list_pool(storage_args_t, Args&&... args) 
+        : policy_holder<Log, 0>{}, 
+        policy_holder<Observer, 1>{}, 
+        pool( std::forward<Args>(args)... ), // parentheses, braces would reject narrowing sizes
+        free_node_list{ self.new_list() }
+    {}
 
-    // default copy/move ctors and assignment are fine, std::vector will care of itself
+    // default copy/move ctors and assignment are fine, the storage will care of itself
     list_pool(const list_pool&) = default;
     list_pool& operator = (const list_pool&) = default; 
     list_pool(list_pool&&) noexcept = default; 
     list_pool& operator = (list_pool&&) noexcept = default; 
 
+    // A binary dump of the pool, lists and free_node_list, that load() can read back. 
+    // The nodes are written as they are in memory, thus Value must be trivially copyable 
+    // and the file can be read only on a machine with the same layout (the header is checked). 
+    // On a stream error std::runtime_error is thrown. 
+    void save(std::ostream& os) const {
+        static_assert( std::is_trivially_copyable<Value>::value, "only pools of trivially copyable values can be saved" ); 
+        self.write_header( os, file_kind::full ); 
+        self.for_each_block( self.pool, [&os](Size, const Node* nodes, Size n) {
+            os.write( reinterpret_cast<const char*>(nodes), std::streamsize(n * sizeof(Node)) ); 
+        } ); 
+        self.check_stream( os ); 
+    }
+    // the number of bytes written by save()
+    std::uint64_t saved_bytes() const noexcept {
+        return sizeof(file_header) + std::uint64_t( self.pool.size() ) * sizeof(Node); 
+    }
+    // replaces the content of the pool with the one saved in is
+    void load(std::istream& is) {
+        static_assert( std::is_trivially_copyable<Value>::value, "only pools of trivially copyable values can be loaded" ); 
+        file_header header{ self.read_header( is, file_kind::full ) }; 
+        Storage<Node> loaded{}; 
+        loaded.reserve( Size(header.size) ); 
+        self.read_nodes( is, header.size, [&loaded](const Node& node) { loaded.emplace_back( node ); } ); 
+        self.pool = std::move( loaded ); 
+        self.free_node_list = Index( header.free_node_list ); 
+        self.clean( self.pool ); // the pool is the file: nothing to write in the next delta
+    }
+
+    // A compact dump of the given lists only (the free nodes are not written), meant for cold storage. 
+    // After the header comes a bitmap of the nodes in the lists (a bit per node of the pool), then the number 
+    // of lists and their lengths (varints), then the nodes of all the lists in traversal order, by blocks of 
+    // compressed_block nodes: the distances from the previously written node (zigzag, bit-packed at the width 
+    // of the largest one of the block, a couple of bits when lists are laid out contiguously), then the values 
+    // of the block through codec (see list_pool_codec). 
+    // heads is any range of list heads, load_compressed() returns them in the same order. 
+    // The lists must not share nodes (e.g. two heads on the same tail after a push_front() on each), 
+    // a node is written once: std::invalid_argument is thrown before anything is written otherwise. 
+    template <typename Heads, typename Codec = list_pool_codec::raw>
+    void save_compressed(std::ostream& os, const Heads& heads, Codec codec = Codec{}) const {
+        // first the lengths, checking that no node is reached twice
+        std::vector<std::uint64_t> lengths; 
+        std::vector<std::uint64_t> listed( ( std::size_t( self.pool.size() ) + 63 ) / 64, 0 ); 
+        for ( Index head : heads ) {
+            self.check_index1( head ); 
+            std::uint64_t length{ 0 }; 
+            for ( Index index{ head }; not self.is_empty(index); index = self.node( index ).next ) {
+                std::uint64_t& word{ listed[ ( index - 1 ) / 64 ] }; 
+                std::uint64_t bit{ std::uint64_t(1) << ( ( index - 1 ) % 64 ) }; 
+                if ( word & bit ) {
+                    throw std::invalid_argument{ "the lists share nodes, save_compressed() writes disjoint lists only" }; 
+                }
+                word |= bit; 
+                ++length; 
+            }
+            lengths.push_back( length ); 
+        }
+
+        self.write_header( os, file_kind::compressed ); 
+        std::streambuf& out{ *os.rdbuf() }; 
+        list_pool_codec::put_bytes( out, listed.data(), listed.size() * sizeof(std::uint64_t) ); 
+        list_pool_codec::put_varint( out, std::uint64_t( lengths.size() ) ); 
+        for ( std::uint64_t length : lengths ) {
+            list_pool_codec::put_varint( out, length ); 
+        }
+
+        std::vector<std::uint64_t> distances, words; 
+        std::vector<Value> values; 
+        distances.reserve( compressed_block ); 
+        values.reserve( compressed_block ); 
+        auto flush = [&] {
+            list_pool_codec::pack( out, distances.data(), distances.size(), words ); 
+            list_pool_codec::encode_values( codec, out, values.data(), values.size(), 0 ); 
+            distances.clear(); 
+            values.clear(); 
+        }; 
+        std::int64_t previous{ 0 }; 
+        for ( Index head : heads ) {
+            for ( Index index{ head }; not self.is_empty(index); index = self.node( index ).next ) {
+                distances.push_back( list_pool_codec::zigzag( std::int64_t(index) - previous ) ); 
+                values.push_back( self.node( index ).value ); 
+                previous = std::int64_t( index ); 
+                if ( distances.size() == compressed_block ) {
+                    flush(); 
+                }
+            }
+        }
+        if ( not distances.empty() ) {
+            flush(); 
+        }
+        self.check_stream( os ); 
+    }
+    // Replaces the content of the pool with the lists saved by save_compressed(), at the very same indices, 
+    // and returns their heads. All the other nodes become free (Value must be default constructible). 
+    // Decoding is streaming, a block at a time: nothing but the pool, the bitmap and the lengths is held in memory. 
+    // Nothing is allocated before the stream has shown that it holds that much: the bitmap is read as it comes 
+    // and bounds the size of the pool (8 nodes per byte), and every list takes at least a byte for its length. 
+    // std::runtime_error is thrown on a truncated or corrupted stream. 
+    // Like load(), it is not told to the operation log: take a new snapshot of the pool afterwards. 
+    template <typename Codec = list_pool_codec::raw>
+    std::vector<Index> load_compressed(std::istream& is, Codec codec = Codec{}) {
+        file_header header{ self.read_header( is, file_kind::compressed ) }; 
+        std::streambuf& in{ *is.rdbuf() }; 
+        if ( header.size > std::uint64_t( std::numeric_limits<Index>::max() ) 
+                or ( header.size / 64 + ( header.size % 64 != 0 ) ) * sizeof(std::uint64_t) > self.bytes_left( in ) ) {
+            throw std::runtime_error{ "the compressed pool is corrupted, invalid size" }; 
+        }
+
+        // the bitmap, a bounded piece at a time (the stream may not tell its size)
+        std::uint64_t bitmap_words{ ( header.size + 63 ) / 64 }, live{ 0 }; 
+        std::vector<std::uint64_t> listed; 
+        while ( listed.size() < bitmap_words ) {
+            std::size_t from{ listed.size() }; 
+            listed.resize( from + std::size_t( std::min<std::uint64_t>( bitmap_words - from, 65536 ) ) ); 
+            list_pool_codec::get_bytes( in, listed.data() + from, ( listed.size() - from ) * sizeof(std::uint64_t) ); 
+        }
+        for ( std::uint64_t word : listed ) {
+            live += std::uint64_t( std::bitset<64>( word ).count() ); 
+        }
+        if ( header.size % 64 != 0 and ( listed.back() >> ( header.size % 64 ) ) != 0 ) {
+            throw std::runtime_error{ "the compressed pool is corrupted, invalid bitmap" }; 
+        }
+
+        // every list takes at least a byte (its length): a count beyond what is left of the stream is corrupted
+        std::uint64_t count{ list_pool_codec::get_varint( in ) }; 
+        std::uint64_t left{ self.bytes_left( in ) }; 
+        if ( count > left ) {
+            throw std::runtime_error{ "the compressed pool is corrupted, too many lists" }; 
+        }
+        std::vector<std::uint64_t> lengths; 
+        lengths.reserve( std::size_t( std::min( count, left ) ) ); 
+        std::uint64_t total{ 0 }; 
+        for ( std::uint64_t h{0}; h < count; ++h ) {
+            lengths.push_back( list_pool_codec::get_varint( in ) ); 
+            if ( lengths.back() > live - total ) {
+                throw std::runtime_error{ "the compressed pool is corrupted, the lengths do not match the bitmap" }; 
+            }
+            total += lengths.back(); 
+        }
+        if ( total != live ) {
+            throw std::runtime_error{ "the compressed pool is corrupted, the lengths do not match the bitmap" }; 
+        }
+
+        Storage<Node> loaded{}; 
+        loaded.reserve( Size(header.size) ); 
+        for ( std::uint64_t i{0}; i < header.size; ++i ) {
+            loaded.emplace_back( Value{}, self.end() ); 
+        }
+        // whatever is not in a list is free, chained in increasing order (the full words are skipped whole)
+        Index free{ self.end() }; 
+        for ( std::uint64_t i{ header.size }; i > 0; --i ) {
+            std::uint64_t word{ listed[ ( i - 1 ) / 64 ] }; 
+            if ( word == ~std::uint64_t(0) ) {
+                i -= ( i - 1 ) % 64; // down to the first node of the word, the loop steps past it
+                continue; 
+            }
+            if ( not ( ( word >> ( ( i - 1 ) % 64 ) ) & 1 ) ) {
+                loaded[ i - 1 ].next = free; 
+                free = Index( i ); 
+            }
+        }
+
+        // the nodes, a block at a time; their bits are cleared as they come, a node seen twice is corrupted
+        std::vector<Index> heads( lengths.size(), self.end() ); 
+        std::vector<std::uint64_t> distances( compressed_block ), words; 
+        std::vector<Value> values( compressed_block ); 
+        std::size_t list{ 0 }; 
+        std::uint64_t placed{ 0 }; // nodes of the current list
+        std::int64_t previous{ 0 }; 
+        Index last{ self.end() }; 
+        for ( std::uint64_t first{0}; first < live; first += compressed_block ) {
+            std::size_t n{ std::size_t( std::min( std::uint64_t( compressed_block ), live - first ) ) }; 
+            list_pool_codec::unpack( in, distances.data(), n, words ); 
+            list_pool_codec::decode_values( codec, in, values.data(), n, 0 ); 
+            for ( std::size_t k{0}; k < n; ) {
+                while ( placed == lengths[ list ] ) { // the sum of the lengths is live, a list is left
+                    ++list; 
+                    placed = 0; 
+                }
+                // the nodes of the block that belong to the current list
+                std::size_t run_end{ k + std::size_t( std::min( std::uint64_t( n - k ), lengths[ list ] - placed ) ) }; 
+                for ( ; k < run_end; ++k ) {
+                    std::int64_t index{ previous + list_pool_codec::unzigzag( distances[k] ) }; 
+                    if ( index <= 0 or std::uint64_t(index) > header.size ) {
+                        throw std::runtime_error{ "the compressed pool is corrupted, invalid index" }; 
+                    }
+                    std::uint64_t& word{ listed[ ( index - 1 ) / 64 ] }; 
+                    std::uint64_t bit{ std::uint64_t(1) << ( ( index - 1 ) % 64 ) }; 
+                    if ( not ( word & bit ) ) {
+                        throw std::runtime_error{ "the compressed pool is corrupted, invalid index" }; 
+                    }
+                    word ^= bit; 
+                    loaded[ index - 1 ].value = std::move( values[k] ); 
+                    if ( placed == 0 ) {
+                        heads[ list ] = Index( index ); 
+                    } else {
+                        loaded[ last - 1 ].next = Index( index ); 
+                    }
+                    ++placed; 
+                    last = Index( index ); 
+                    previous = index; 
+                }
+            }
+        }
+        self.pool = std::move( loaded ); 
+        self.free_node_list = free; 
+        return heads; 
+    }
+
+    // Export of the given lists as an Arrow ListArray: offsets (int32 or int64) has one entry per list 
+    // plus one, the values of list i are values[ offsets[i] ] ... values[ offsets[i+1] - 1 ]. 
+    // Both buffers are provided by the caller, 64-byte aligned as Arrow wants (std::invalid_argument otherwise). 
+    // It takes two passes: arrow_offsets() sizes the output (it returns the number of values), then, 
+    // once the values buffer is there, export_arrow() fills it. 
+    // Lists are independent, so both passes can split them among threads (threads <= 1 means no threads). 
+    template <typename Heads, typename Offset>
+    std::size_t arrow_offsets(const Heads& heads, Offset* offsets, unsigned threads = 1) const {
+        static_assert( std::is_integral<Offset>::value and std::is_signed<Offset>::value, "Arrow offsets are int32 or int64" ); 
+        self.check_alignment( offsets ); 
+        std::size_t lists{ std::size_t( std::distance(std::begin(heads), std::end(heads)) ) }; 
+        // the heads are checked here, an exception cannot escape from a worker thread
+        for ( std::size_t i{0}; i < lists; ++i ) {
+            self.check_index1( std::begin(heads)[i] ); 
+        }
+        // first the lengths, in parallel, at offsets[i+1]...
+        self.parallel_for( lists, threads, [&](std::size_t first, std::size_t last) {
+            for ( std::size_t i{first}; i < last; ++i ) {
+                Offset length{ 0 }; 
+                for ( Index index{ std::begin(heads)[i] }; not self.is_empty(index); index = self.node( index ).next ) {
+                    ++length; 
+                }
+                offsets[ i + 1 ] = length; 
+            }
+        } ); 
+        // ...then their prefix sum
+        std::size_t total{ 0 }; 
+        offsets[0] = 0; 
+        for ( std::size_t i{1}; i <= lists; ++i ) {
+            total += std::size_t( offsets[i] ); 
+            if ( total > std::size_t( std::numeric_limits<Offset>::max() ) ) {
+                throw std::length_error{ "too many values for the Arrow offset type" }; 
+            }
+            offsets[i] = Offset( total ); 
+        }
+        return total; 
+    }
+    template <typename Heads, typename Offset>
+    void export_arrow(const Heads& heads, const Offset* offsets, Value* values, unsigned threads = 1) const {
+        static_assert( std::is_trivially_copyable<Value>::value, "Arrow values must be trivially copyable" ); 
+        self.check_alignment( offsets ); 
+        self.check_alignment( values ); 
+        std::size_t lists{ std::size_t( std::distance(std::begin(heads), std::end(heads)) ) }; 
+        // as in arrow_offsets(), the heads are checked before the workers start
+        for ( std::size_t i{0}; i < lists; ++i ) {
+            self.check_index1( std::begin(heads)[i] ); 
+        }
+        self.parallel_for( lists, threads, [&](std::size_t first, std::size_t last) {
+            for ( std::size_t i{first}; i < last; ++i ) {
+                Value* value{ values + offsets[i] }; 
+                for ( Index index{ std::begin(heads)[i] }; not self.is_empty(index); index = self.node( index ).next ) {
+                    *value++ = self.node( index ).value; 
+                }
+            }
+        } ); 
+    }
+    // The inverse of the export: the lists are appended to the pool as brand new nodes (the free nodes 
+    // are not used), each one laid out contiguously and already linked. Returns the heads of the lists. 
+    // value_count is the length of values: the offsets are checked against it (not negative, not decreasing, 
+    // within values) before anything is allocated, std::invalid_argument is thrown otherwise. 
+    // Like compact(), it is not told to the operation log. 
+    template <typename Offset>
+    std::vector<Index> import_arrow(const Offset* offsets, std::size_t lists, const Value* values, std::size_t value_count) {
+        if ( offsets[0] < 0 ) {
+            throw std::invalid_argument{ "the Arrow offsets must not be negative" }; 
+        }
+        for ( std::size_t i{0}; i < lists; ++i ) {
+            if ( offsets[i + 1] < offsets[i] ) {
+                throw std::invalid_argument{ "the Arrow offsets must not decrease" }; 
+            }
+        }
+        if ( std::uint64_t( offsets[ lists ] ) > value_count ) {
+            throw std::invalid_argument{ "the Arrow offsets go beyond the values" }; 
+        }
+        std::size_t total{ std::size_t( offsets[ lists ] - offsets[0] ) }; 
+        if ( std::uint64_t( self.pool.size() ) + total > std::uint64_t( std::numeric_limits<Index>::max() ) ) {
+            throw std::length_error{ "the lists do not fit in the index type of the pool" }; 
+        }
+        self.reserve( self.pool.size() + total ); 
+        std::vector<Index> heads( lists, self.end() ); 
+        for ( std::size_t i{0}; i < lists; ++i ) {
+            for ( Offset k{ offsets[i] }; k < offsets[i + 1]; ++k ) {
+                // the next node is the one that will be appended right after this one
+                Index next{ k + 1 < offsets[i + 1] ? Index( self.pool.size() + 2 ) : self.end() }; 
+                self.pool.emplace_back( values[k], next ); 
+                if ( k == offsets[i] ) {
+                    heads[i] = Index( self.pool.size() ); 
+                }
+            }
+        }
+        return heads; 
+    }
+
+    // Incremental checkpoints, only with chunked_storage (the storage tracks which chunks are dirty): 
+    // checkpoint() writes a full save() and starts tracking, then each checkpoint_delta() 
+    // writes only the chunks modified since the previous checkpoint (full or delta). 
+    // The state at any checkpoint is restored by restore( base, delta1, ..., deltaN ). 
+    // Reads through the const interface (value() const, next() const, cbegin()...) leave the chunks clean, 
+    // dereferencing a non-const iterator counts as a write; a pool just loaded or restored is clean. 
+    void checkpoint(std::ostream& os) {
+        self.save( os ); 
+        self.pool.clear_dirty(); 
+    }
+    void checkpoint_delta(std::ostream& os) {
+        static_assert( std::is_trivially_copyable<Value>::value, "only pools of trivially copyable values can be saved" ); 
+        self.write_header( os, file_kind::delta ); 
+        for ( Size c{0}; c < self.pool.chunk_count(); ++c ) {
+            if ( not self.pool.is_dirty(c) ) {
+                continue; 
+            }
+            std::uint64_t chunk[2]{ c, self.pool.chunk_elements(c) }; 
+            os.write( reinterpret_cast<const char*>(chunk), sizeof(chunk) ); 
+            os.write( reinterpret_cast<const char*>(self.pool.chunk_data(c)), std::streamsize(chunk[1] * sizeof(Node)) ); 
+        }
+        std::uint64_t last[2]{ std::uint64_t(-1), 0 }; 
+        os.write( reinterpret_cast<const char*>(last), sizeof(last) ); 
+        self.check_stream( os ); 
+        self.pool.clear_dirty(); 
+    }
+    // brings a pool restored from the previous checkpoint to the state of the one that wrote the delta
+    void apply_delta(std::istream& is) {
+        static_assert( std::is_trivially_copyable<Value>::value, "only pools of trivially copyable values can be loaded" ); 
+        file_header header{ self.read_header( is, file_kind::delta ) }; 
+        while (true) {
+            std::uint64_t chunk[2]; 
+            is.read( reinterpret_cast<char*>(chunk), sizeof(chunk) ); 
+            self.check_stream( is ); 
+            if ( chunk[0] == std::uint64_t(-1) ) {
+                break; 
+            }
+            Size first{ Size(chunk[0]) * Storage<Node>::chunk_size }; 
+            // the chunks come in order and the new nodes always dirty their chunk, 
+            // so a node is either already there or it is the next one to be appended
+            self.read_nodes( is, chunk[1], [this, &first](const Node& node) {
+                if ( first < self.pool.size() ) {
+                    self.pool[ first ] = node; 
+                } else {
+                    self.pool.emplace_back( node ); 
+                }
+                ++first; 
+            } ); 
+        }
+        if ( header.size != self.pool.size() ) {
+            throw std::runtime_error{ "the delta does not apply to this pool" }; 
+        }
+        self.free_node_list = Index( header.free_node_list ); 
+        self.clean( self.pool ); 
+    }
+    template <typename... Deltas>
+    void restore(std::istream& base, Deltas&... deltas) {
+        self.load( base ); 
+        // C++14 has no fold expressions, a braced list guarantees the order of evaluation
+        int in_order[]{ 0, ( self.apply_delta(deltas), 0 )... }; 
+        (void) in_order; 
+    }
+
+    // the logging policy, e.g. for opening or committing the log
+    Log& operation_log() noexcept {
+        return self.logger(); 
+    }
+
+    // the storage of the nodes, read-only, e.g. for the seqlock of shm_storage
+    const Storage<Node>& storage() const noexcept {
+        return self.pool; 
+    }
+
+    // the instrumentation policy, e.g. for reading its counters
+    Observer& observer() noexcept {
+        return self.hooks(); 
+    }
+    const Observer& observer() const noexcept {
+        return self.hooks(); 
+    }
+
+    // a consistent, read-only copy of the whole pool (lists and free_node_list), e.g. for a background reader. 
+    // With chunked_storage it shares the chunks with the live pool, thus it costs O(#chunks), 
+    // and the live pool clones a chunk only the first time it writes to it afterwards. 
+    // With vector_storage it is a plain copy. 
+    std::shared_ptr<const list_pool> snapshot() const {
+        return std::make_shared<const list_pool>( self ); 
+    }
+
 
     using iterator = list_pool_iterator::Iter<list_pool, Value, Index>;
     using const_iterator = list_pool_iterator::Iter<const list_pool, const Value, Index>;
@@ -150,11 +1121,13 @@ class list_pool {
 
     // creating an iterator cannot go wrong, thus alla these methods are noexcept
     iterator begin(Index index) noexcept {
+        self.hooks().on_traverse( index ); 
         return iterator{ &self, index };  
     }
     iterator end(Index) noexcept { // this is not a typo
         return iterator{ &self, self.end() }; 
     }
+    // const traversals are not observed, see no_observer
     const_iterator begin(Index index) const noexcept {
         return const_iterator{ &self, index }; 
     }
@@ -173,7 +1146,7 @@ class list_pool {
         return self.end(); 
     }
 
-    // std::vector<Node>::reserve() might throw, so this cannot be noexcept
+    // Storage<Node>::reserve() might throw, so this cannot be noexcept
     void reserve(Size n) { // reserve n nodes in the pool
         self.pool.reserve( n ); 
     }
@@ -189,6 +1162,50 @@ class list_pool {
         return ( self.end() == head ); 
     }
 
+    // The number of nodes of a list. Lengths are not stored anywhere (it would cost an Index per list 
+    // and a write per push/free), so this is a walk: O(length). 
+    Size length(Index head) const {
+        self.check_index1( head ); 
+        Size n{ 0 }; 
+        for ( Index index{ head }; not self.is_empty(index); index = self.node( index ).next ) {
+            ++n; 
+        }
+        return n; 
+    }
+
+    // Memory accounting, e.g. for charging the tenants owning the lists of a shared pool. 
+    // The bytes of a list: its nodes and, through heap_bytes (see value_heap_bytes), what its values own. 
+    template <typename HeapBytes = value_heap_bytes<Value>>
+    std::size_t memory_usage(Index head, HeapBytes heap_bytes = HeapBytes{}) const {
+        self.check_index1( head ); 
+        std::size_t bytes{ 0 }; 
+        for ( Index index{ head }; not self.is_empty(index); index = self.node( index ).next ) {
+            bytes += sizeof(Node) + heap_bytes( self.node( index ).value ); 
+        }
+        return bytes; 
+    }
+    // The whole pool: live nodes (in some list), free nodes and reserved capacity. 
+    // O(size()), it walks free_node_list; free nodes keep their old values, hence their heap bytes. 
+    template <typename HeapBytes = value_heap_bytes<Value>>
+    pool_memory memory_report(HeapBytes heap_bytes = HeapBytes{}) const {
+        pool_memory report{}; 
+        std::vector<bool> free( self.pool.size() + 1, false ); 
+        for ( Index index{ self.free_node_list }; not self.is_empty(index); index = self.node( index ).next ) {
+            free[ index ] = true; 
+            ++report.free_nodes; 
+            report.free_bytes += sizeof(Node) + heap_bytes( self.node( index ).value ); 
+        }
+        for ( Size index{1}; index <= self.pool.size(); ++index ) {
+            if ( not free[ index ] ) {
+                ++report.live_nodes; 
+                report.live_bytes += sizeof(Node) + heap_bytes( self.node( Index(index) ).value ); 
+            }
+        }
+        report.reserved_nodes = std::size_t( self.pool.capacity() - self.pool.size() ); 
+        report.reserved_bytes = report.reserved_nodes * sizeof(Node); 
+        return report; 
+    }
+
     // should this method be static? 
     Index end() const noexcept { 
         return Index( 0 ); 
@@ -199,9 +1216,11 @@ class list_pool {
         self.check_index2( index ); 
         return self.node( index ).value;
     }
-    // the non-const version is called to avoid code duplication
+    // the const accessors go through the const node(): a read never clones a shared chunk 
+    // nor marks it dirty, so any number of threads can read a snapshot() 
     const Value& value(Index index) const {
-        return $deconst(list_pool).value( index ); 
+        self.check_index2( index ); 
+        return self.node( index ).value;
     }
 
     // when an out-of-range index is passed an expception is thrown
@@ -209,9 +1228,9 @@ class list_pool {
         self.check_index2( index ); 
         return self.node( index ).next;  
     }
-    // the non-const version is called to avoid code duplication
     const Index& next(Index index) const {
-        return $deconst(list_pool).next( index ); 
+        self.check_index2( index ); 
+        return self.node( index ).next;  
     }
     
     Index push_front(const Value& value, Index head) {
@@ -241,10 +1260,12 @@ class list_pool {
         // here we could also say nothing and simply return self.end() in the case in which head is out of range, 
         // but this silent error could indicate and be the cause of broader and more widespread bugs in the code using this class
         self.check_index1( head ); 
+        auto timing = self.hooks().begin( pool_op::free ); 
         
         // the node to be deleted is identified and its next (to be returned to the caller of this method) is stored
         Node& node{ self.node( head ) }; 
         Index next{ node.next }; 
+        self.logger().free( head ); 
 
         // the node to be deleted is simply prepended to free_node_list. 
         // Important: node.value is not deleted, this will (maybe) happen later when 
@@ -252,6 +1273,9 @@ class list_pool {
         // be called on node.value
         node.next = self.free_node_list; 
         self.free_node_list = head; 
+        self.hooks().on_free( head ); 
+        LIST_POOL_PROBE1( free, std::uint64_t(head) ); 
+        self.hooks().end( pool_op::free, timing ); 
         return next; 
     }
                 
@@ -267,14 +1291,21 @@ class list_pool {
         
         // the same reasoning as for free() holds here as well 
         self.check_index1( head ); 
+        auto timing = self.hooks().begin( pool_op::free_list ); 
         
         // the tail of the list is identified and it is made aware that now its 
         // next node is the head of the free_node_list 
-        Node& tail{ self.node( self.get_tail(head) ) }; 
+        std::size_t walked{ 0 }; 
+        Node& tail{ self.node( self.get_tail(head, walked) ) }; 
+        self.hooks().on_tail_walk( walked ); 
+        self.logger().free_list( head ); 
         tail.next = self.free_node_list; 
  
         // now x becomes the head of the free_node_list 
         self.free_node_list = head; 
+        self.hooks().on_free_list( head ); 
+        LIST_POOL_PROBE2( free_list, std::uint64_t(head), std::uint64_t(walked + 1) ); 
+        self.hooks().end( pool_op::free_list, timing ); 
 
         // I return a new empty list. 
         // Now x is very dangerous: the list identified by x is gone and now x, 
@@ -282,78 +1313,484 @@ class list_pool {
         return self.new_list(); 
     }
 
+    // Fragmentation: after a lot of churn free_node_list hands out nodes in the scrambled order they were
+    // freed, and a list ends up spread all over the pool (a cache miss, maybe a TLB miss, per node). 
+
+    // The address-ordered free list policy: the free nodes are chained again in increasing index order, 
+    // so that what is pushed next is laid out (almost) contiguously. O(size()), meant to be called 
+    // now and then, e.g. after a burst of frees; nothing else changes, all the indices stay valid. 
+    void sort_free_list() {
+        self.make_writable(); 
+        std::vector<bool> free( self.pool.size() + 1, false ); 
+        for ( Index index{ self.free_node_list }; not self.is_empty(index); index = self.node( index ).next ) {
+            free[ index ] = true; 
+        }
+        Index next{ self.end() }; 
+        for ( Size index{ self.pool.size() }; index > 0; --index ) {
+            if ( free[ index ] ) {
+                self.node( Index(index) ).next = next; 
+                next = Index( index ); 
+            }
+        }
+        self.free_node_list = next; 
+    }
+
+    // Compaction: the nodes are moved so that the lists in heads are laid out at the front of the pool, 
+    // one after the other, each one contiguously in traversal order; the free nodes follow, in increasing 
+    // order. Any node that no list in heads reaches is freed. heads (any range of Index) is updated 
+    // in place, every other index into the pool becomes invalid. Lists sharing a tail keep sharing it. 
+    // O(size()) time and O(size()) indices of extra memory, the nodes are swapped in place. 
+    // The operation log is not told: take a new snapshot (and truncate the log) after a compaction. 
+    template <typename Heads>
+    void compact(Heads& heads) {
+        for ( Index head : heads ) {
+            self.check_index1( head ); 
+        }
+        self.make_writable(); 
+        Size n{ self.pool.size() }; 
+
+        // where each node goes, position[0] is the end of a list and stays there
+        std::vector<Index> position( n + 1, self.end() ); 
+        Size placed{ 0 }; 
+        for ( Index head : heads ) {
+            for ( Index index{ head }; not self.is_empty(index) and self.is_empty(position[ index ]); index = self.node( index ).next ) {
+                position[ index ] = Index( ++placed ); 
+            }
+        }
+        Size live{ placed }; 
+        for ( Size index{1}; index <= n; ++index ) {
+            if ( self.is_empty(position[ index ]) ) {
+                position[ index ] = Index( ++placed ); 
+            }
+        }
+
+        // the links and the heads are renamed before the nodes move...
+        for ( Size index{1}; index <= n; ++index ) {
+            if ( position[ index ] <= live ) {
+                Index& next{ self.node( Index(index) ).next }; 
+                next = position[ next ]; 
+            }
+        }
+        for ( auto& head : heads ) {
+            head = position[ head ]; 
+        }
+        // ...then the permutation is applied one cycle at a time: the node at index goes to position[index]
+        for ( Size index{1}; index <= n; ++index ) {
+            while ( position[ index ] != index ) {
+                Index target{ position[ index ] }; 
+                std::swap( self.node( Index(index) ), self.node( target ) ); 
+                std::swap( position[ index ], position[ target ] ); 
+            }
+        }
+        for ( Size index{ live + 1 }; index <= n; ++index ) {
+            self.node( Index(index) ).next = ( index < n ? Index( index + 1 ) : self.end() ); 
+        }
+        self.free_node_list = ( live < n ? Index( live + 1 ) : self.end() ); 
+        LIST_POOL_PROBE2( compact, std::uint64_t(live), std::uint64_t(n) ); 
+    }
+
+    // Garbage collection, for pools where a head may get dropped without a free_list(): roots (any range 
+    // of Index) are all the live heads, every node that no root reaches and that is not free already 
+    // is spliced into free_node_list. Returns the number of nodes reclaimed. 
+    // The reachable nodes are marked in a bitmap, the roots split among threads (threads <= 1 means 
+    // no threads), then a single sweep over the pool frees the unmarked ones. All the roots stay valid. 
+    // Like compact(), it is not told to the operation log. 
+    template <typename Roots>
+    std::size_t collect(const Roots& roots, unsigned threads = 1) {
+        std::size_t n{ std::size_t( self.pool.size() ) }; 
+        std::size_t count{ std::size_t( std::distance(std::begin(roots), std::end(roots)) ) }; 
+        // the roots are checked here, an exception cannot escape from a worker thread
+        for ( std::size_t i{0}; i < count; ++i ) {
+            self.check_index1( std::begin(roots)[i] ); 
+        }
+        self.make_writable(); 
+
+        // bit i of the map is node i; lists sharing a tail stop at the first node already marked
+        std::size_t words{ n / 64 + 1 }; 
+        std::unique_ptr<std::atomic<std::uint64_t>[]> marks{ new std::atomic<std::uint64_t>[words] }; 
+        for ( std::size_t w{0}; w < words; ++w ) {
+            marks[w].store( 0, std::memory_order_relaxed ); 
+        }
+        auto mark = [&marks](Index index) noexcept {
+            std::uint64_t bit{ std::uint64_t(1) << (index % 64) }; 
+            return ( marks[ index / 64 ].fetch_or( bit, std::memory_order_relaxed ) & bit ) == 0; 
+        }; 
+        self.parallel_for( count, threads, [&](std::size_t first, std::size_t last) {
+            const list_pool& pool{ self }; // reading only, the workers share the nodes
+            for ( std::size_t i{first}; i < last; ++i ) {
+                for ( Index index{ std::begin(roots)[i] }; not pool.is_empty(index) and mark( index ); index = pool.node( index ).next ) {
+                }
+            }
+        } ); 
+        for ( Index index{ self.free_node_list }; not self.is_empty(index); index = self.node( index ).next ) {
+            mark( index ); 
+        }
+
+        // the sweep goes backwards, so that the reclaimed nodes are handed out in increasing order
+        std::size_t reclaimed{ 0 }; 
+        for ( std::size_t index{ n }; index > 0; --index ) {
+            if ( ( marks[ index / 64 ].load(std::memory_order_relaxed) >> (index % 64) & 1 ) == 0 ) {
+                self.node( Index(index) ).next = self.free_node_list; 
+                self.free_node_list = Index( index ); 
+                ++reclaimed; 
+            }
+        }
+        LIST_POOL_PROBE1( collect, std::uint64_t(reclaimed) ); 
+        return reclaimed; 
+    }
+
+    // Hot/cold segregation: a compact() where the lists are laid out by decreasing heat(head) (e.g. the 
+    // access counts of access_sampler in pool_observers.hpp), so that the few lists receiving most 
+    // of the traversals end up together in a dense region at the front of the pool, and fit in the caches 
+    // and in the TLB reach; the coldest lists go last, just before the free nodes. 
+    // heads is updated in place and keeps its order, everything said for compact() holds. 
+    template <typename Heads, typename Heat>
+    void segregate(Heads& heads, Heat&& heat) {
+        std::vector<Index> hottest( std::begin(heads), std::end(heads) ); 
+        std::vector<std::size_t> order( hottest.size() ); 
+        std::vector<decltype( heat( hottest[0] ) )> heats; 
+        heats.reserve( hottest.size() ); 
+        for ( std::size_t i{0}; i < hottest.size(); ++i ) {
+            order[i] = i; 
+            heats.push_back( heat( hottest[i] ) ); 
+        }
+        std::stable_sort( order.begin(), order.end(), [&heats](std::size_t a, std::size_t b) { return heats[b] < heats[a]; } ); 
+        for ( std::size_t i{0}; i < order.size(); ++i ) {
+            hottest[i] = std::begin(heads)[ order[i] ]; 
+        }
+        self.compact( hottest ); 
+        for ( std::size_t i{0}; i < order.size(); ++i ) {
+            std::begin(heads)[ order[i] ] = hottest[i]; 
+        }
+    }
+
+    // Merging and splitting pools, e.g. the pools of sharded jobs, or a few lists shipped out of a huge pool. 
+
+    // All the nodes of other (live and free) are appended after those of this pool, in the same order: 
+    // a list with head h in other has head h + offset here, where offset (the returned value) is the old 
+    // size(). The links are rebased by a single pass adding offset to every non-empty next, branch-free 
+    // so that it vectorizes, and the free nodes of other join free_node_list. 
+    // Like compact(), it is not told to the operation log. 
+    Index absorb(const list_pool& other) {
+        Size offset{ self.pool.size() }, n{ other.pool.size() }; 
+        if ( std::uint64_t( offset ) + n > std::uint64_t( std::numeric_limits<Index>::max() ) ) {
+            throw std::length_error{ "the pools do not fit in the index type of the pool" }; 
+        }
+        self.reserve( offset + n ); 
+        for ( Size index{0}; index < n; ++index ) {
+            self.pool.emplace_back( other.pool[ index ] ); 
+        }
+        Index shift{ Index( offset ) }; 
+        for ( Size index{ offset + 1 }; index <= offset + n; ++index ) {
+            Index& next{ self.node( Index(index) ).next }; 
+            next += Index( next != self.end() ) * shift; 
+        }
+        if ( not other.is_empty( other.free_node_list ) ) {
+            Index head{ Index( other.free_node_list + shift ) }; 
+            self.node( self.get_tail( head ) ).next = self.free_node_list; 
+            self.free_node_list = head; 
+        }
+        return shift; 
+    }
+
+    // A new pool holding copies of the lists in heads (any range of Index) and nothing else, each one 
+    // laid out contiguously in traversal order, as compact() would; lists sharing a tail keep sharing it. 
+    // heads is updated in place to the indices of the new pool (keep a copy to go on using the lists 
+    // here, this pool does not change). For n nodes walked it takes O(n) (expected) time and O(n) memory, 
+    // whatever the size of this pool: the map from the old indices to the new ones is a hash map of those nodes. 
+    template <typename Heads>
+    list_pool extract(Heads& heads) const {
+        // the nodes of the lists in traversal order, lists sharing a tail walk it more than once
+        std::vector<Index> walked; 
+        std::vector<std::size_t> lengths; 
+        for ( Index head : heads ) {
+            self.check_index1( head ); 
+            std::size_t before{ walked.size() }; 
+            for ( Index index{ head }; not self.is_empty(index); index = self.node( index ).next ) {
+                walked.push_back( index ); 
+            }
+            lengths.push_back( walked.size() - before ); 
+        }
+        // where the nodes went (empty until they are copied), for shared tails: an open-addressing hash map 
+        // from the old indices to the new ones, at most half full 
+        unsigned bits{ 1 }; 
+        while ( (std::size_t(1) << bits) < 2 * walked.size() ) {
+            ++bits; 
+        }
+        std::vector<std::pair<Index, Index>> position( std::size_t(1) << bits, std::make_pair( self.end(), self.end() ) ); 
+        std::size_t mask{ position.size() - 1 }; 
+        list_pool extracted{}; 
+        extracted.reserve( Size( walked.size() ) ); // more than enough with shared tails 
+        auto walk = walked.cbegin(); 
+        auto length = lengths.cbegin(); 
+        for ( auto& head : heads ) {
+            Index previous{ self.end() }; // the last copy of this list, linked to the next one
+            auto end = walk + std::ptrdiff_t( *length++ ); 
+            for ( ; walk != end; ++walk ) {
+                Index index{ *walk }; 
+                std::size_t slot{ std::size_t( (std::uint64_t(index) * 0x9e3779b97f4a7c15ULL) >> (64 - bits) ) }; 
+                while ( position[ slot ].first != index and not self.is_empty( position[ slot ].first ) ) {
+                    slot = (slot + 1) & mask; 
+                }
+                position[ slot ].first = index; 
+                Index& placed{ position[ slot ].second }; 
+                bool shared{ not self.is_empty(placed) }; 
+                if ( not shared ) {
+                    extracted.pool.emplace_back( self.node( index ).value, self.end() ); 
+                    placed = Index( extracted.pool.size() ); 
+                }
+                if ( self.is_empty(previous) ) {
+                    head = placed; 
+                } else {
+                    extracted.node( previous ).next = placed; 
+                }
+                if ( shared ) {
+                    break; 
+                }
+                previous = placed; 
+            }
+            walk = end; 
+        }
+        return extracted; 
+    }
+
     private: 
-    // this method is not marked as "noexcept" because both std::vector<Node>::emplace_back() and 
+    // With a copy-on-write storage, writing to a node might have to clone its chunk, hence throw: 
+    // the passes relinking many nodes first clone whatever is shared, so they cannot fail half-way. 
+    void make_writable() {
+        self.unshare( self.pool ); 
+    }
+    template <typename Nodes>
+    static void unshare(Nodes&) noexcept {}
+    template <std::size_t ChunkBits>
+    static void unshare(chunked_vector<Node, ChunkBits>& nodes) {
+        nodes.unshare(); 
+    }
+    // forgets which chunks have been written, only the chunked storage keeps track
+    template <typename Nodes>
+    static void clean(Nodes&) noexcept {}
+    template <std::size_t ChunkBits>
+    static void clean(chunked_vector<Node, ChunkBits>& nodes) noexcept {
+        nodes.clear_dirty(); 
+    }
+
+    // this method is not marked as "noexcept" because both Storage<Node>::emplace_back() and 
     // Value& Value::operator = (const Value&) could throw an expectation.
     // The 'f' in front of the names of the method and of the type expresses that this is a "forwarding" reference.
+    // It returns the index of a node holding value and pointing to next, either a brand new one (fresh is set) or 
+    // one recycled from free_node_list. If it throws, the pool is left untouched. 
+    // The observer is not told about the allocation here, see allocate_logged(). 
+    template <typename fValue> 
+    Index allocate(fValue&& value, Index next, bool& fresh) {
+        if ( self.is_empty(self.free_node_list) ) {
+            // there are no available free nodes in free_node_list, so we must allocate a new one. 
+            Size capacity{ self.pool.capacity() }; 
+            self.pool.emplace_back( std::forward<fValue>(value), next );  
+            if ( self.pool.capacity() != capacity ) {
+                self.hooks().on_growth( capacity, self.pool.capacity() ); 
+                // only a std::vector moves the nodes it already has when it grows
+                LIST_POOL_PROBE3( growth, std::uint64_t(capacity), std::uint64_t(self.pool.capacity()), 
+                        std::uint64_t( std::is_same<Storage<Node>, std::vector<Node>>::value ? (self.pool.size() - 1) * sizeof(Node) : 0 ) ); 
+            }
+            fresh = true; 
+            return Index( self.pool.size() ); // the index + 1, just what we need 
+        } 
+
+        // we reuse the first node of free_node_list 
+        Index index{ self.free_node_list }; 
+        Node& node = self.node( index ); 
+
+        // node.value is replaced by the given value.
+        // Only at this moment node.value is destroyed by Value's copy or move assignment operator. 
+        node.value = std::forward<fValue>( value ); 
+
+        // the first node of free_node_list is popped from free_node_list 
+        // and its successor become the new head of free_node_list 
+        self.free_node_list = node.next; 
+        node.next = next; 
+        fresh = false; 
+        return index; 
+    }
+
     template <typename fValue> 
     Index fpush_front(fValue&& value, Index head) {
         // head is allowed to be 0, we will simply add the first element to an empty list. 
         // However we must check that head <= self.pool.size().
         self.check_index1( head );
+        auto timing = self.hooks().begin( pool_op::push_front ); 
 
         // the "index" of the newly added node will be returned. 
-        // Because we are pushing in front of the current newhead of the list, 
+        // Because we are pushing in front of the current head of the list, 
         // it will identify the new head.
-        Index newhead; 
-
-        if ( self.is_empty(self.free_node_list) ) {
-            // there are no available free nodes in free_node_list, so we must allocate a new one. 
-            self.pool.emplace_back( std::forward<fValue>(value), head );  
-            newhead = self.pool.size(); // the index + 1, just what we need 
-
-        } else {
-            // we reuse the first node of free_node_list 
-            newhead = self.free_node_list; 
-            
-            // the first node of free_node_list (newhead) is popped from free_node_list 
-            // and its successor become the new newhead of free_node_list 
-            Node& node = self.node( newhead ); 
-            self.free_node_list = node.next; 
-
-            // node.value is replaced by the given value.
-            // Only at this moment node.value is destroyed by Value's copy or move assignment operator. 
-            node.value = std::forward<fValue>( value ); 
-            node.next = head; 
-        }
+        Index newhead{ self.allocate_logged( std::forward<fValue>(value), head, 
+                [&](const Value& added){ self.logger().push_front( added, head ); } ) }; 
+        self.hooks().end( pool_op::push_front, timing ); 
         return newhead; 
     }
     
-    // this method is not marked as "noexcept" because both std::vector<Node>::emplace_back() and 
-    // Value& Value::operator = (const Value&) could throw an expectation.
-    // The 'f' in front of the names of the method and of the type expresses that this is a "forwarding" reference.
     template <typename fValue> 
     Index fpush_back(fValue&& value, Index head) {
-        // if the list is empty we delegate adding the first element to fpush_front()
+        self.check_index1( head );
+        auto timing = self.hooks().begin( pool_op::push_back ); 
+
+        // if the list is empty the new node is the new head 
         if ( self.is_empty(head) ) {
-            return self.fpush_front( std::forward<fValue>(value), head ); 
+            Index newhead{ self.allocate_logged( std::forward<fValue>(value), head, 
+                    [&](const Value& added){ self.logger().push_back( added, head ); } ) }; 
+            self.hooks().end( pool_op::push_back, timing ); 
+            return newhead; 
         }
 
-        Index tail{ self.get_tail(head) }; 
+        std::size_t walked{ 0 }; 
+        Index tail{ self.get_tail(head, walked) }; 
+        self.hooks().on_tail_walk( walked ); 
+        Index added{ self.allocate_logged( std::forward<fValue>(value), self.end(), 
+                [&](const Value& pushed){ self.logger().push_back( pushed, head ); } ) }; 
+        // the storage might have been reallocated, the tail is looked up again
+        self.node( tail ).next = added; 
+        self.hooks().end( pool_op::push_back, timing ); 
+        return head; 
+    }
 
-        if ( self.is_empty(self.free_node_list) ) {
-            // there are no available free nodes in free_node_list, so we must allocate a new one. 
-            self.pool.emplace_back( std::forward<fValue>(value), self.end() );  
-            self.next( tail ) = self.pool.size(); // the index + 1, just what we need 
-            
+    // allocates a node and logs its push, calling log_push(value) while no list links to it yet. If the log throws, 
+    // the node goes back to free_node_list (unlogged, the log never heard of it) and the push does not happen. 
+    // Only a logged node is reported to the observer (and to the probes), a failed push is not counted. 
+    template <typename fValue, typename Log_push>
+    Index allocate_logged(fValue&& value, Index next, Log_push&& log_push) {
+        bool fresh{ false }; 
+        Index added{ self.allocate( std::forward<fValue>(value), next, fresh ) }; 
+        try {
+            log_push( self.node( added ).value ); 
+        } catch (...) {
+            self.node( added ).next = self.free_node_list; 
+            self.free_node_list = added; 
+            throw; 
+        }
+        if ( fresh ) {
+            self.hooks().on_allocate_fresh( added ); 
+            LIST_POOL_PROBE1( alloc_fresh, std::uint64_t(added) ); 
         } else {
-            // we reuse the first node of free_node_list. 
-            self.next(tail) = self.free_node_list; 
+            self.hooks().on_allocate_recycled( added ); 
+            LIST_POOL_PROBE1( alloc_recycled, std::uint64_t(added) ); 
+        }
+        return added; 
+    }
+
+    
+    enum class file_kind : std::uint32_t { full = 1, delta = 2, compressed = 3 }; 
+    // the nodes of a block of the compressed format 
+    static constexpr std::size_t compressed_block{ 1024 }; 
 
-            // the first node of free_node_list (newhead) is popped from free_node_list 
-            // and its successor become the new head of free_node_list 
-            Node& node = self.node( self.free_node_list ); 
-            self.free_node_list = node.next; 
+    struct file_header {
+        char magic[8]; 
+        file_kind kind; 
+        std::uint32_t node_size; 
+        std::uint32_t value_size; 
+        std::uint32_t index_size; 
+        std::uint64_t size; 
+        std::uint64_t free_node_list; 
+    }; 
+
+    static constexpr const char* magic() noexcept { return "listpool"; }
 
-            // node.value is replaced by the given value.
-            // Only at this moment node.value is destroyed by Value's copy or move assignment operator. 
-            node.value = std::forward<fValue>( value ); 
-            node.next = self.end(); 
+    void check_stream(const std::ios& stream) const {
+        if ( not stream ) {
+            throw std::runtime_error{ "error while reading or writing the pool" }; 
         }
-        return head; 
     }
 
-    
+    void write_header(std::ostream& os, file_kind kind) const {
+        file_header header{}; 
+        std::memcpy( header.magic, self.magic(), sizeof(header.magic) ); 
+        header.kind = kind; 
+        header.node_size = sizeof(Node); 
+        header.value_size = sizeof(Value); 
+        header.index_size = sizeof(Index); 
+        header.size = self.pool.size(); 
+        header.free_node_list = self.free_node_list; 
+        os.write( reinterpret_cast<const char*>(&header), sizeof(header) ); 
+    }
+    file_header read_header(std::istream& is, file_kind kind) const {
+        file_header header; 
+        is.read( reinterpret_cast<char*>(&header), sizeof(header) ); 
+        self.check_stream( is ); 
+        if ( std::memcmp(header.magic, self.magic(), sizeof(header.magic)) != 0 or header.kind != kind 
+                or header.node_size != sizeof(Node) or header.value_size != sizeof(Value) or header.index_size != sizeof(Index) ) {
+            throw std::runtime_error{ "the stream does not contain a compatible list_pool" }; 
+        }
+        return header; 
+    }
+
+    // what is left to read in the stream, or the largest count when the stream cannot seek
+    static std::uint64_t bytes_left(std::streambuf& in) {
+        std::streamoff here{ in.pubseekoff( 0, std::ios::cur, std::ios::in ) }; 
+        if ( here < 0 ) {
+            return std::numeric_limits<std::uint64_t>::max(); 
+        }
+        std::streamoff end{ in.pubseekoff( 0, std::ios::end, std::ios::in ) }; 
+        in.pubseekpos( here, std::ios::in ); 
+        return end < here ? 0 : std::uint64_t( end - here ); 
+    }
+
+    // reads n nodes from is, a block at a time, and hands them one by one to f
+    template <typename F>
+    void read_nodes(std::istream& is, std::uint64_t n, F&& f) const {
+        constexpr std::size_t block{ 4096 }; 
+        std::unique_ptr<typename std::aligned_storage<sizeof(Node), alignof(Node)>::type[]> buffer{ 
+            new typename std::aligned_storage<sizeof(Node), alignof(Node)>::type[block] }; 
+        const Node* nodes{ reinterpret_cast<const Node*>(buffer.get()) }; 
+        while ( n > 0 ) {
+            std::size_t count{ std::size_t( std::min<std::uint64_t>(n, block) ) }; 
+            is.read( reinterpret_cast<char*>(buffer.get()), std::streamsize(count * sizeof(Node)) ); 
+            self.check_stream( is ); 
+            for ( std::size_t i{0}; i < count; ++i ) {
+                f( nodes[i] ); 
+            }
+            n -= count; 
+        }
+    }
+
+    // the nodes as contiguous blocks: f(index of the first node - 1, pointer to the first node, number of nodes)
+    // any contiguous storage (std::vector, shm_storage) is a single block
+    template <typename Nodes, typename F>
+    static void for_each_block(const Nodes& nodes, F&& f) {
+        if ( not nodes.empty() ) {
+            f( Size(0), nodes.data(), nodes.size() ); 
+        }
+    }
+    template <std::size_t ChunkBits, typename F>
+    static void for_each_block(const chunked_vector<Node, ChunkBits>& nodes, F&& f) {
+        for ( Size c{0}; c < nodes.chunk_count() and nodes.chunk_elements(c) > 0; ++c ) {
+            f( c << ChunkBits, nodes.chunk_data(c), nodes.chunk_elements(c) ); 
+        }
+    }
+
+
+    static void check_alignment(const void* buffer) {
+        if ( reinterpret_cast<std::uintptr_t>(buffer) % 64 != 0 ) {
+            throw std::invalid_argument{ "the buffer must be 64-byte aligned" }; 
+        }
+    }
+
+    // calls f(first, last) on threads contiguous slices of [0, n), each on its own thread
+    template <typename F>
+    static void parallel_for(std::size_t n, unsigned threads, F&& f) {
+        if ( threads <= 1 or n < 2 ) {
+            f( std::size_t(0), n ); 
+            return; 
+        }
+        threads = unsigned( std::min<std::size_t>(threads, n) ); 
+        std::vector<std::thread> workers; 
+        std::size_t slice{ (n + threads - 1) / threads }; 
+        for ( std::size_t first{0}; first < n; first += slice ) {
+            workers.emplace_back( [&f, first, slice, n]() { f( first, std::min(first + slice, n) ); } ); 
+        }
+        for ( std::thread& worker : workers ) {
+            worker.join(); 
+        }
+    }
+
+
     // two simple methods ensuring that the given index is in range
     void check_index1(const Index& index) const {
         if ( index > self.pool.size() ) {
@@ -370,8 +1807,14 @@ class list_pool {
 
     // a helper method for getting the tail of a list given the index of one of its nodes. 
     // The index of the tail is so that self.is_empty( self.next(index) ) is true.
+    // The number of nodes walked (the length of the list from index, minus one) is stored in walked.
     Index get_tail(Index index) const noexcept {
+        std::size_t walked; 
+        return self.get_tail( index, walked ); 
+    }
+    Index get_tail(Index index, std::size_t& walked) const noexcept {
         Index next; 
+        walked = 0; 
         // we already know that index is is_empty(index) is false, so it is safe
         while (true) {
             next = self.node( index ).next;
@@ -379,10 +1822,14 @@ class list_pool {
                 break; 
             }
             index = next; 
+            ++walked; 
         }
         return index; 
     }
 };
 
+// the default policies are empty bases: a list_pool takes the room of its storage and free_node_list, no more
+static_assert( sizeof(list_pool<int>) == sizeof(std::pair<vector_storage<int>, std::size_t>), "no_log and no_observer must take no room" ); 
+
 #undef self
 #endif // __list_pool_header_guard__
@@ -0,0 +1,253 @@
+#ifndef __multi_list_pool_header_guard__
+#define __multi_list_pool_header_guard__
+
+#include "list_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+// A pool whose nodes have N links instead of one: a value (a record) is stored once and threaded through
+// up to N independent lists, one per link, e.g. the records of a user, of a session and of a time bucket.
+// Link k is chosen at compile time, push_front<k>(record, head) puts the record at the front of a list of
+// link k and begin<k>(head) walks that list; the lists of different links ignore each other.
+// A record belongs to at most one list per link (it has a single next for it). A node remembers the links it
+// is on, and goes back to the free list once the last list holding it lets it go (free<k>() or free_list<k>());
+// a record that was created but never linked stays until it is, or until release().
+// As in list_pool, index 0 is the empty list and a node is at index + 1 in the storage.
+template <typename Value, std::size_t N, typename Index = std::size_t, template <typename> class Storage = vector_storage>
+class multi_list_pool {
+    static_assert( N > 0 and N <= 32, "between 1 and 32 links per node" );
+
+    struct Node {
+        Value value;
+        Index next[N];
+        std::uint32_t links; // bit k: the node is on a list of link k
+        bool free; // on the free list: releasing or linking it again would corrupt the free list
+
+        template <typename V>
+        explicit Node(V&& value) : value( std::forward<V>(value) ), next{}, links{ 0 }, free{ false } {}
+    };
+
+    public:
+    using value_type = Value;
+    using list_type = Index;
+    using size_type = typename Storage<Node>::size_type;
+
+    private:
+    Storage<Node> pool;
+    Index free_node_list; // chained through next[0]
+
+    Node& node(Index index) { return self.pool[ index - 1 ]; }
+    const Node& node(Index index) const { return self.pool[ index - 1 ]; }
+
+    void check_index(Index index) const {
+        if ( index == Index(0) or index > self.pool.size() ) {
+            throw std::invalid_argument{ "the value of the provided index is invalid" };
+        }
+    }
+
+    // the record leaves a list of link k, and the pool if it is on no other list
+    void unlink(std::size_t k, Index index) {
+        Node& n{ self.node( index ) };
+        n.links &= ~( std::uint32_t(1) << k );
+        if ( n.links == 0 ) {
+            self.push_free( index );
+        }
+    }
+
+    void push_free(Index index) noexcept {
+        Node& n{ self.node( index ) };
+        n.next[0] = self.free_node_list;
+        n.free = true;
+        self.free_node_list = index;
+    }
+
+    void check_record(Index record) const {
+        self.check_index( record );
+        if ( self.node( record ).free ) {
+            throw std::logic_error{ "the record has already been released" };
+        }
+    }
+
+    public:
+    // a forward iterator over the values of a list of link K
+    template <std::size_t K>
+    class const_iterator {
+        friend multi_list_pool;
+
+        const multi_list_pool* owner;
+        Index current;
+
+        const_iterator(const multi_list_pool* owner, Index current) noexcept
+            : owner{ owner },
+            current{ current }
+        {}
+
+        public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Value*;
+        using reference = const Value&;
+
+        reference operator * () const {
+            return (*self.owner).value( self.current );
+        }
+        pointer operator -> () const {
+            return &**this;
+        }
+        // the record under the iterator, e.g. to walk its other lists
+        Index index() const noexcept {
+            return self.current;
+        }
+        const_iterator& operator ++ () {
+            self.current = (*self.owner).template next<K>( self.current );
+            return self;
+        }
+        const_iterator operator ++ (int) {
+            const_iterator old{ self };
+            ++self;
+            return old;
+        }
+        bool operator == (const const_iterator& other) const noexcept {
+            return self.current == other.current;
+        }
+        bool operator != (const const_iterator& other) const noexcept {
+            return not ( self == other );
+        }
+    };
+
+    multi_list_pool() : pool{}, free_node_list{ self.new_list() } {}
+    explicit multi_list_pool(size_type n) : multi_list_pool() {
+        self.reserve( n );
+    }
+
+    Index new_list() const noexcept {
+        return Index( 0 );
+    }
+    Index end() const noexcept {
+        return Index( 0 );
+    }
+    bool is_empty(Index head) const noexcept {
+        return head == Index( 0 );
+    }
+
+    // a new record, on no list yet
+    Index new_record(Value value) {
+        if ( self.is_empty( self.free_node_list ) ) {
+            if ( self.pool.size() >= size_type( std::numeric_limits<Index>::max() ) ) {
+                throw std::overflow_error{ "the indices of the pool are exhausted" };
+            }
+            self.pool.emplace_back( std::move(value) );
+            return Index( self.pool.size() );
+        }
+        Index index{ self.free_node_list };
+        Node& n{ self.node( index ) };
+        n.value = std::move( value );
+        n.free = false;
+        self.free_node_list = n.next[0];
+        for ( Index& next : n.next ) {
+            next = self.end();
+        }
+        return index;
+    }
+    // drops a record that is on no list (e.g. a new_record() that was never linked), once
+    void release(Index record) {
+        self.check_record( record );
+        if ( self.node( record ).links != 0 ) {
+            throw std::logic_error{ "releasing a record that is still on some list" };
+        }
+        self.push_free( record );
+    }
+
+    // puts the record at the front of a list of link k, returns the new head (the record)
+    template <std::size_t k>
+    Index push_front(Index record, Index head) {
+        static_assert( k < N, "no such link" );
+        self.check_record( record );
+        Node& n{ self.node( record ) };
+        if ( n.links & ( std::uint32_t(1) << k ) ) {
+            throw std::logic_error{ "the record is already on a list of this link" };
+        }
+        n.next[k] = head;
+        n.links |= std::uint32_t(1) << k;
+        return record;
+    }
+    // removes the first record of a list of link k, returns the new head
+    template <std::size_t k>
+    Index free(Index head) {
+        static_assert( k < N, "no such link" );
+        if ( self.is_empty( head ) ) {
+            return head;
+        }
+        if ( not self.template is_linked<k>( head ) ) {
+            throw std::logic_error{ "the record is not on a list of this link" };
+        }
+        Index next{ self.node( head ).next[k] };
+        self.unlink( k, head );
+        return next;
+    }
+    // empties a list of link k, in O(length) as every record has to leave the link on its own
+    template <std::size_t k>
+    Index free_list(Index head) {
+        while ( not self.is_empty( head ) ) {
+            head = self.template free<k>( head );
+        }
+        return self.new_list();
+    }
+
+    Value& value(Index index) {
+        self.check_index( index );
+        return self.node( index ).value;
+    }
+    const Value& value(Index index) const {
+        self.check_index( index );
+        return self.node( index ).value;
+    }
+    template <std::size_t k>
+    Index next(Index index) const {
+        static_assert( k < N, "no such link" );
+        self.check_index( index );
+        return self.node( index ).next[k];
+    }
+    // whether the record is on a list of link k
+    template <std::size_t k>
+    bool is_linked(Index index) const {
+        static_assert( k < N, "no such link" );
+        self.check_index( index );
+        return ( self.node( index ).links >> k ) & 1u;
+    }
+
+    template <std::size_t k>
+    const_iterator<k> begin(Index head) const noexcept {
+        static_assert( k < N, "no such link" );
+        return const_iterator<k>{ &self, head };
+    }
+    template <std::size_t k>
+    const_iterator<k> end(Index) const noexcept {
+        static_assert( k < N, "no such link" );
+        return const_iterator<k>{ &self, self.end() };
+    }
+
+    void reserve(size_type n) {
+        self.pool.reserve( n );
+    }
+    size_type size() const noexcept {
+        return self.pool.size();
+    }
+    size_type capacity() const noexcept {
+        return self.pool.capacity();
+    }
+};
+
+#undef self
+#endif // __multi_list_pool_header_guard__
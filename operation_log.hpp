@@ -0,0 +1,245 @@
+#ifndef __operation_log_header_guard__
+#define __operation_log_header_guard__
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+// A logging policy for list_pool (the fourth template parameter) that appends every mutation
+// (push_front, push_back, free, free_list, with their arguments) to an append-only file.
+// Records are buffered and written with a single write() + fdatasync() every group_size operations
+// (group commit): an operation is durable once commit() has returned, either explicitly or because
+// the group was full. group_size == 1 means that every operation is flushed immediately.
+//
+// Recovery: load() the last snapshot into a pool, then replay() the log written since that snapshot.
+// After taking a new snapshot the log can be truncate()d.
+// Values are logged as they are in memory, so they must be trivially copyable.
+//
+// list_pool logs an operation before applying it. When the log throws (an I/O error while committing a group),
+// the pool does not apply the operation, and the log drops its record if none of the buffer reached the file,
+// so the two still agree. If part of the buffer did reach the file (a short write, or a failed fdatasync() after
+// a write), the log cannot tell what is durable anymore: it is broken, and every further operation throws
+// until it is truncate()d after a new snapshot.
+class write_ahead_log {
+    public:
+    enum class op : std::uint8_t { push_front = 1, push_back = 2, free = 3, free_list = 4 };
+
+    private:
+    int fd;
+    std::size_t group_size;
+    std::size_t pending; // operations in the buffer
+    std::vector<char> buffer;
+    bool broken; // a commit failed after writing part of the buffer
+
+    [[noreturn]] static void fail(const char* what) {
+        throw std::system_error{ errno, std::generic_category(), what };
+    }
+
+    void append(const void* data, std::size_t size) {
+        const char* bytes{ static_cast<const char*>(data) };
+        self.buffer.insert( self.buffer.end(), bytes, bytes + size );
+    }
+
+    // a record is the operation, the head it was applied to and, for pushes, the value
+    void record(op operation, std::uint64_t head, const void* value, std::size_t size) {
+        if ( self.fd < 0 ) {
+            return;
+        }
+        if ( self.broken ) {
+            throw std::runtime_error{ "the operation log is broken, truncate it after a new snapshot" };
+        }
+        std::size_t mark{ self.buffer.size() };
+        self.append( &operation, sizeof(operation) );
+        self.append( &head, sizeof(head) );
+        self.append( value, size );
+        if ( ++self.pending >= self.group_size ) {
+            try {
+                self.commit();
+            } catch (...) {
+                // the operation will not be applied, it must not be written later either
+                if ( not self.broken ) {
+                    self.buffer.resize( mark );
+                    --self.pending;
+                }
+                throw;
+            }
+        }
+    }
+
+    public:
+    // a closed log records nothing, open() it for logging
+    write_ahead_log() noexcept
+        : fd{ -1 },
+        group_size{ 1 },
+        pending{ 0 },
+        buffer{},
+        broken{ false }
+    {}
+    write_ahead_log(const std::string& path, std::size_t group_size) : write_ahead_log() {
+        self.open( path, group_size );
+    }
+    ~write_ahead_log() {
+        try {
+            self.close();
+        } catch (...) {
+            // nothing sensible to do in a destructor, what was not committed is lost
+        }
+    }
+
+    // the file descriptor is owned, thus the log can be moved but not copied
+    write_ahead_log(const write_ahead_log&) = delete;
+    write_ahead_log& operator = (const write_ahead_log&) = delete;
+    write_ahead_log(write_ahead_log&& other) noexcept : write_ahead_log() {
+        self.swap( other );
+    }
+    write_ahead_log& operator = (write_ahead_log&& rhs) noexcept {
+        self.swap( rhs );
+        return self;
+    }
+    void swap(write_ahead_log& other) noexcept {
+        std::swap( self.fd, other.fd );
+        std::swap( self.group_size, other.group_size );
+        std::swap( self.pending, other.pending );
+        std::swap( self.buffer, other.buffer );
+        std::swap( self.broken, other.broken );
+    }
+
+    void open(const std::string& path, std::size_t group_size) {
+        self.close();
+        self.fd = ::open( path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644 );
+        if ( self.fd < 0 ) {
+            self.fail( "cannot open the operation log" );
+        }
+        self.group_size = ( group_size == 0 ? 1 : group_size );
+    }
+    void close() {
+        if ( self.fd < 0 ) {
+            return;
+        }
+        if ( not self.broken ) { // a broken log has nothing left worth writing
+            self.commit();
+        }
+        ::close( self.fd );
+        self.fd = -1;
+        self.buffer.clear();
+        self.pending = 0;
+        self.broken = false;
+    }
+    bool is_open() const noexcept {
+        return ( self.fd >= 0 );
+    }
+
+    // writes the buffered records with a single write() and makes them durable
+    void commit() {
+        std::size_t written{ 0 };
+        while ( written < self.buffer.size() ) {
+            ssize_t n{ ::write( self.fd, self.buffer.data() + written, self.buffer.size() - written ) };
+            if ( n < 0 ) {
+                if ( errno == EINTR ) {
+                    continue;
+                }
+                self.broken = ( written > 0 );
+                self.fail( "cannot write the operation log" );
+            }
+            written += std::size_t( n );
+        }
+        if ( written > 0 and ::fdatasync( self.fd ) != 0 ) {
+            self.broken = true;
+            self.fail( "cannot sync the operation log" );
+        }
+        self.buffer.clear();
+        self.pending = 0;
+    }
+
+    // drops the whole log, to be called once the pool has been snapshotted
+    void truncate() {
+        self.buffer.clear();
+        self.pending = 0;
+        self.broken = false;
+        if ( self.fd >= 0 and ::ftruncate( self.fd, 0 ) != 0 ) {
+            self.fail( "cannot truncate the operation log" );
+        }
+    }
+
+    // the policy interface, called by list_pool before each mutation takes effect
+    template <typename Value, typename Index>
+    void push_front(const Value& value, Index head) {
+        static_assert( std::is_trivially_copyable<Value>::value, "only trivially copyable values can be logged" );
+        self.record( op::push_front, std::uint64_t(head), &value, sizeof(Value) );
+    }
+    template <typename Value, typename Index>
+    void push_back(const Value& value, Index head) {
+        static_assert( std::is_trivially_copyable<Value>::value, "only trivially copyable values can be logged" );
+        self.record( op::push_back, std::uint64_t(head), &value, sizeof(Value) );
+    }
+    template <typename Index>
+    void free(Index head) {
+        self.record( op::free, std::uint64_t(head), nullptr, 0 );
+    }
+    template <typename Index>
+    void free_list(Index head) {
+        self.record( op::free_list, std::uint64_t(head), nullptr, 0 );
+    }
+
+    // Applies the operations logged in the file to pool, which must be in the state the log started from.
+    // The pool should not log itself (or it would log everything again). A torn record at the end
+    // of the file (a crash in the middle of a write) is ignored. Returns the number of operations replayed.
+    template <typename Pool>
+    static std::size_t replay(const std::string& path, Pool& pool) {
+        using Value = typename Pool::value_type;
+        using Index = typename Pool::list_type;
+        static_assert( std::is_trivially_copyable<Value>::value, "only trivially copyable values can be logged" );
+
+        std::ifstream is{ path, std::ios::binary };
+        if ( not is ) {
+            throw std::runtime_error{ "cannot open the operation log " + path };
+        }
+        std::size_t replayed{ 0 };
+        while (true) {
+            op operation;
+            std::uint64_t head;
+            if ( not is.read( reinterpret_cast<char*>(&operation), sizeof(operation) )
+                    or not is.read( reinterpret_cast<char*>(&head), sizeof(head) ) ) {
+                break;
+            }
+            if ( operation == op::push_front or operation == op::push_back ) {
+                typename std::aligned_storage<sizeof(Value), alignof(Value)>::type raw;
+                if ( not is.read( reinterpret_cast<char*>(&raw), sizeof(Value) ) ) {
+                    break;
+                }
+                const Value& value{ *reinterpret_cast<const Value*>(&raw) };
+                if ( operation == op::push_front ) {
+                    pool.push_front( value, Index(head) );
+                } else {
+                    pool.push_back( value, Index(head) );
+                }
+            } else if ( operation == op::free ) {
+                pool.free( Index(head) );
+            } else if ( operation == op::free_list ) {
+                pool.free_list( Index(head) );
+            } else {
+                throw std::runtime_error{ "corrupted operation log " + path };
+            }
+            ++replayed;
+        }
+        return replayed;
+    }
+};
+
+#undef self
+#endif // __operation_log_header_guard__
@@ -0,0 +1,243 @@
+#ifndef __operation_trace_header_guard__
+#define __operation_trace_header_guard__
+
+#include "list_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+// Recording the operations applied to a pool in production, and replaying them against any other
+// pool configuration (see replay.cpp, `make replay`).
+//
+// A trace does not refer to nodes, whose indices depend on the pool, but to lists: every list gets
+// a small id when its first node is pushed, the id is kept while the list changes head and it is
+// reused once the list has been emptied. Values are not recorded either, only their size in bytes,
+// the replay makes up values of that size. A trace is the magic number followed by the records,
+// each one the operation as a byte then, as varints, the list id and, for pushes, the value size
+// (for reserve, the number of nodes and nothing else).
+
+enum class trace_op : std::uint8_t { reserve = 0, push_front = 1, push_back = 2, free = 3, free_list = 4 };
+
+struct trace_record {
+    trace_op op;
+    std::uint64_t list; // the list id, unused for reserve
+    std::uint64_t size; // the value size for pushes, the number of nodes for reserve
+};
+
+constexpr std::uint64_t trace_magic{ 0x31656361727470ULL }; // "ptrace1"
+
+// the default size of a recorded value: its own bytes, without what it might own on the heap
+struct trace_value_size {
+    template <typename Value>
+    std::size_t operator () (const Value&) const noexcept {
+        return sizeof(Value);
+    }
+};
+
+
+// Wraps a pool and records every mutation made through it to os, reads go to pool() directly.
+// Only heads of lists may be passed to the operations: a node in the middle of a list is
+// not a list the trace knows about, and std::invalid_argument is thrown.
+template <typename Pool, typename ValueSize = trace_value_size>
+class trace_recorder {
+    public:
+    using value_type = typename Pool::value_type;
+    using list_type = typename Pool::list_type;
+    using size_type = typename Pool::size_type;
+
+    private:
+    Pool& traced;
+    std::streambuf& out;
+    ValueSize value_size;
+    std::unordered_map<list_type, std::uint64_t> ids; // the head of each non-empty list and its id
+    std::vector<std::uint64_t> unused_ids;
+    std::uint64_t next_id;
+
+    void put(trace_op op, std::uint64_t first, std::uint64_t second, bool both) {
+        list_pool_codec::put_byte( self.out, static_cast<unsigned char>(op) );
+        list_pool_codec::put_varint( self.out, first );
+        if ( both ) {
+            list_pool_codec::put_varint( self.out, second );
+        }
+    }
+
+    // the id of the list whose head is head, a new one if the list is empty
+    std::uint64_t id_of(list_type head) {
+        if ( self.traced.is_empty( head ) ) {
+            if ( self.unused_ids.empty() ) {
+                return self.next_id++;
+            }
+            std::uint64_t id{ self.unused_ids.back() };
+            self.unused_ids.pop_back();
+            return id;
+        }
+        auto found = self.ids.find( head );
+        if ( found == self.ids.end() ) {
+            throw std::invalid_argument{ "only the heads of the lists can be traced" };
+        }
+        return found->second;
+    }
+    // the list id now has head as head
+    void move_to(std::uint64_t id, list_type old_head, list_type head) {
+        if ( not self.traced.is_empty( old_head ) ) {
+            self.ids.erase( old_head );
+        }
+        if ( self.traced.is_empty( head ) ) {
+            self.unused_ids.push_back( id );
+        } else {
+            self.ids[ head ] = id;
+        }
+    }
+
+    public:
+    // writes the magic number right away, the records follow as operations are made
+    trace_recorder(Pool& pool, std::ostream& os, ValueSize value_size = ValueSize{})
+        : traced{ pool },
+        out{ *os.rdbuf() },
+        value_size{ std::move(value_size) },
+        ids{},
+        unused_ids{},
+        next_id{ 0 }
+    {
+        list_pool_codec::put_varint( self.out, trace_magic );
+    }
+
+    Pool& pool() noexcept {
+        return self.traced;
+    }
+    const Pool& pool() const noexcept {
+        return self.traced;
+    }
+
+    list_type new_list() noexcept {
+        return self.traced.new_list();
+    }
+    void reserve(size_type n) {
+        self.traced.reserve( n );
+        self.put( trace_op::reserve, std::uint64_t(n), 0, false );
+    }
+    template <typename V>
+    list_type push_front(V&& value, list_type head) {
+        std::uint64_t id{ self.id_of( head ) };
+        std::uint64_t size{ self.value_size( value ) };
+        list_type pushed{ self.traced.push_front( std::forward<V>(value), head ) };
+        self.move_to( id, head, pushed );
+        self.put( trace_op::push_front, id, size, true );
+        return pushed;
+    }
+    template <typename V>
+    list_type push_back(V&& value, list_type head) {
+        std::uint64_t id{ self.id_of( head ) };
+        std::uint64_t size{ self.value_size( value ) };
+        list_type pushed{ self.traced.push_back( std::forward<V>(value), head ) };
+        self.move_to( id, head, pushed );
+        self.put( trace_op::push_back, id, size, true );
+        return pushed;
+    }
+    list_type free(list_type head) {
+        if ( self.traced.is_empty( head ) ) {
+            return head;
+        }
+        std::uint64_t id{ self.id_of( head ) };
+        list_type next{ self.traced.free( head ) };
+        self.move_to( id, head, next );
+        self.put( trace_op::free, id, 0, false );
+        return next;
+    }
+    list_type free_list(list_type head) {
+        if ( self.traced.is_empty( head ) ) {
+            return head;
+        }
+        std::uint64_t id{ self.id_of( head ) };
+        list_type freed{ self.traced.free_list( head ) };
+        self.move_to( id, head, freed );
+        self.put( trace_op::free_list, id, 0, false );
+        return freed;
+    }
+};
+
+
+// reads a whole trace, so that replaying it is not slowed down by the decoding
+inline std::vector<trace_record> read_trace(std::istream& is) {
+    std::streambuf& in{ *is.rdbuf() };
+    std::vector<trace_record> records;
+    try {
+        if ( list_pool_codec::get_varint( in ) != trace_magic ) {
+            throw std::runtime_error{ "this is not an operation trace" };
+        }
+        while ( not std::streambuf::traits_type::eq_int_type( in.sgetc(), std::streambuf::traits_type::eof() ) ) {
+            trace_record record{ static_cast<trace_op>( list_pool_codec::get_byte( in ) ), 0, 0 };
+            if ( record.op > trace_op::free_list ) {
+                throw std::runtime_error{ "the operation trace is corrupted" };
+            }
+            if ( record.op == trace_op::reserve ) {
+                record.size = list_pool_codec::get_varint( in );
+                records.push_back( record );
+                continue;
+            }
+            record.list = list_pool_codec::get_varint( in );
+            if ( record.op == trace_op::push_front or record.op == trace_op::push_back ) {
+                record.size = list_pool_codec::get_varint( in );
+            }
+            records.push_back( record );
+        }
+    } catch (const std::runtime_error&) {
+        throw std::runtime_error{ "the operation trace is truncated or corrupted" };
+    }
+    return records;
+}
+
+// Applies one record to pool; heads[id] is the head of the list id, the vector grows as new ids show up.
+// make_value(size) makes up the value of a push.
+template <typename Pool, typename MakeValue>
+void replay_record(Pool& pool, std::vector<typename Pool::list_type>& heads, const trace_record& record,
+        MakeValue&& make_value) {
+    if ( record.op == trace_op::reserve ) {
+        pool.reserve( typename Pool::size_type(record.size) );
+        return;
+    }
+    if ( record.list >= heads.size() ) {
+        heads.resize( std::size_t(record.list) + 1, pool.new_list() );
+    }
+    auto& head = heads[ std::size_t(record.list) ];
+    switch ( record.op ) {
+        case trace_op::push_front:
+            head = pool.push_front( make_value( std::size_t(record.size) ), head );
+            break;
+        case trace_op::push_back:
+            head = pool.push_back( make_value( std::size_t(record.size) ), head );
+            break;
+        case trace_op::free:
+            head = pool.free( head );
+            break;
+        case trace_op::free_list:
+            head = pool.free_list( head );
+            break;
+        case trace_op::reserve:
+            break;
+    }
+}
+
+// replays the whole trace read from is and returns the heads of the lists, by id
+template <typename Pool, typename MakeValue>
+std::vector<typename Pool::list_type> replay_trace(std::istream& is, Pool& pool, MakeValue&& make_value) {
+    std::vector<typename Pool::list_type> heads;
+    for ( const trace_record& record : read_trace( is ) ) {
+        replay_record( pool, heads, record, make_value );
+    }
+    return heads;
+}
+
+#undef self
+#endif // __operation_trace_header_guard__
@@ -0,0 +1,114 @@
+#ifndef __perf_counters_header_guard__
+#define __perf_counters_header_guard__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+// Hardware counters of the calling thread through Linux perf_event_open(), for the benchmarks.
+// Each counter is opened on its own, so the ones the CPU (or the virtual machine) does not have are
+// simply skipped; in a container without perf events none of them opens and available() is false,
+// the benchmarks then fall back to timing only. Only user space is counted.
+class perf_counters {
+    public:
+    struct counter {
+        std::string name;
+        std::uint64_t value; // scaled, if the kernel had to multiplex the counters
+    };
+
+    private:
+    struct event {
+        const char* name;
+        std::uint32_t type;
+        std::uint64_t config;
+    };
+
+    static constexpr std::uint64_t cache(std::uint64_t which, std::uint64_t op, std::uint64_t result) noexcept {
+        return which | ( op << 8 ) | ( result << 16 );
+    }
+
+    std::vector<int> fds;
+    std::vector<counter> counters;
+
+    static int open_event(const event& e) noexcept {
+        perf_event_attr attr;
+        std::memset( &attr, 0, sizeof(attr) );
+        attr.size = sizeof(attr);
+        attr.type = e.type;
+        attr.config = e.config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return int( ::syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 ) );
+    }
+
+    public:
+    perf_counters() {
+        const event events[]{
+            { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { "L1d-misses", PERF_TYPE_HW_CACHE,
+                self.cache( PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS ) },
+            { "LLC-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { "dTLB-misses", PERF_TYPE_HW_CACHE,
+                self.cache( PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS ) },
+            { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        };
+        for ( const event& e : events ) {
+            int fd{ self.open_event( e ) };
+            if ( fd >= 0 ) {
+                self.fds.push_back( fd );
+                self.counters.push_back( counter{ e.name, 0 } );
+            }
+        }
+    }
+    ~perf_counters() {
+        for ( int fd : self.fds ) {
+            ::close( fd );
+        }
+    }
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator = (const perf_counters&) = delete;
+
+    bool available() const noexcept {
+        return not self.fds.empty();
+    }
+
+    void start() noexcept {
+        for ( int fd : self.fds ) {
+            ::ioctl( fd, PERF_EVENT_IOC_RESET, 0 );
+            ::ioctl( fd, PERF_EVENT_IOC_ENABLE, 0 );
+        }
+    }
+    // stops counting and returns what has been counted since start()
+    const std::vector<counter>& stop() noexcept {
+        for ( int fd : self.fds ) {
+            ::ioctl( fd, PERF_EVENT_IOC_DISABLE, 0 );
+        }
+        for ( std::size_t i{0}; i < self.fds.size(); ++i ) {
+            std::uint64_t data[3]{ 0, 0, 0 }; // value, time enabled, time running
+            if ( ::read( self.fds[i], data, sizeof(data) ) != ssize_t(sizeof(data)) or data[2] == 0 ) {
+                self.counters[i].value = 0;
+                continue;
+            }
+            self.counters[i].value = std::uint64_t( double(data[0]) * double(data[1]) / double(data[2]) );
+        }
+        return self.counters;
+    }
+};
+
+#undef self
+#endif // __perf_counters_header_guard__
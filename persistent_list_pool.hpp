@@ -0,0 +1,182 @@
+#ifndef __persistent_list_pool_header_guard__
+#define __persistent_list_pool_header_guard__
+
+#include "list_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+// Persistent (immutable, cons-style) lists with structural sharing: push_front() never touches the list
+// it pushes onto, it returns a new version whose tail is the old one, so a new version costs a single node
+// and any number of versions can share a long common tail.
+// Nodes carry a reference count (Count, 32 bits by default), counting the versions held by the caller
+// (each index returned by push_front() or retain() is one reference) and the nodes linking to them.
+// release() drops a reference, and a node goes back to the pool only once its count reaches zero,
+// together with the nodes of its tail that nobody else refers to.
+// Values are immutable, there is no push_back() (it would change every version sharing the tail).
+template <typename Value, typename Index = std::size_t, template <typename> class Storage = vector_storage,
+        typename Count = std::uint32_t>
+class persistent_list_pool {
+    static_assert( std::is_unsigned<Count>::value, "reference counts are unsigned" );
+
+    struct counted {
+        Value value;
+        Count refs;
+    };
+
+    public:
+    using pool_type = list_pool<counted, Index, Storage>;
+    using value_type = Value;
+    using list_type = Index;
+    using size_type = typename pool_type::size_type;
+
+    private:
+    pool_type pool;
+
+    void retain_node(Index index) {
+        if ( self.pool.is_empty( index ) ) {
+            return;
+        }
+        Count& refs{ self.pool.value( index ).refs };
+        if ( refs == std::numeric_limits<Count>::max() ) {
+            throw std::overflow_error{ "too many references to a node of a persistent list" };
+        }
+        ++refs;
+    }
+
+    public:
+    // a forward iterator over the values of a version
+    class const_iterator {
+        friend persistent_list_pool;
+
+        const persistent_list_pool* owner;
+        Index current;
+
+        const_iterator(const persistent_list_pool* owner, Index current) noexcept
+            : owner{ owner },
+            current{ current }
+        {}
+
+        public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Value*;
+        using reference = const Value&;
+
+        reference operator * () const {
+            return (*self.owner).value( self.current );
+        }
+        pointer operator -> () const {
+            return &**this;
+        }
+        const_iterator& operator ++ () {
+            self.current = (*self.owner).next( self.current );
+            return self;
+        }
+        const_iterator operator ++ (int) {
+            const_iterator old{ self };
+            ++self;
+            return old;
+        }
+        bool operator == (const const_iterator& other) const noexcept {
+            return self.current == other.current;
+        }
+        bool operator != (const const_iterator& other) const noexcept {
+            return not ( self == other );
+        }
+    };
+
+    persistent_list_pool() = default;
+    explicit persistent_list_pool(size_type n) : pool{ n } {}
+
+    Index new_list() noexcept {
+        return self.pool.new_list();
+    }
+    bool is_empty(Index head) const noexcept {
+        return self.pool.is_empty( head );
+    }
+    Index end() const noexcept {
+        return self.pool.end();
+    }
+
+    // a new version: value followed by tail, which is shared (and stays valid for the caller)
+    Index push_front(Value value, Index tail) {
+        self.retain_node( tail );
+        try {
+            return self.pool.push_front( counted{ std::move(value), Count(1) }, tail );
+        } catch (...) {
+            if ( not self.is_empty( tail ) ) {
+                --self.pool.value( tail ).refs;
+            }
+            throw;
+        }
+    }
+    // one more reference to the version head, to be released on its own
+    Index retain(Index head) {
+        self.retain_node( head );
+        return head;
+    }
+    // the version without its first value: a new reference to the tail, head stays valid
+    Index rest(Index head) {
+        return self.retain( self.next( head ) );
+    }
+    // Drops a reference to the version head: its nodes that are no longer referred to go back to the pool,
+    // up to the first one shared with another version. Returns the number of nodes freed.
+    std::size_t release(Index head) {
+        if ( not self.is_empty( head ) and self.refs( head ) == 0 ) {
+            throw std::logic_error{ "releasing a node of a persistent list that has already been freed" };
+        }
+        std::size_t freed{ 0 };
+        while ( not self.is_empty( head ) and --self.pool.value( head ).refs == 0 ) {
+            head = self.pool.free( head );
+            ++freed;
+        }
+        return freed;
+    }
+
+    const Value& value(Index index) const {
+        return self.pool.value( index ).value;
+    }
+    Index next(Index index) const {
+        return self.pool.next( index );
+    }
+    // the references to a node: the versions starting there and the nodes linking to it
+    Count refs(Index index) const {
+        return self.pool.value( index ).refs;
+    }
+
+    const_iterator begin(Index head) const noexcept {
+        return const_iterator{ &self, head };
+    }
+    const_iterator end(Index) const noexcept {
+        return const_iterator{ &self, self.end() };
+    }
+
+    void reserve(size_type n) {
+        self.pool.reserve( n );
+    }
+    size_type size() const noexcept {
+        return self.pool.size();
+    }
+    size_type capacity() const noexcept {
+        return self.pool.capacity();
+    }
+    // the underlying pool, e.g. for its memory_report()
+    const pool_type& nodes() const noexcept {
+        return self.pool;
+    }
+};
+
+#undef self
+#endif // __persistent_list_pool_header_guard__
@@ -0,0 +1,165 @@
+#ifndef __pool_observers_header_guard__
+#define __pool_observers_header_guard__
+
+#include "list_pool.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+// ready-made observers for list_pool (the fifth template parameter), see no_observer for the hooks
+
+
+// the timestamp counter where there is one (x86), the steady clock in nanoseconds everywhere else
+inline std::uint64_t pool_timestamp() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() ).count() );
+#endif
+}
+
+
+// plain event counters, a handful of increments per operation
+struct counting_observer : no_observer {
+    std::uint64_t fresh_allocations{ 0 };
+    std::uint64_t recycled_allocations{ 0 };
+    std::uint64_t frees{ 0 };
+    std::uint64_t list_frees{ 0 };
+    std::uint64_t growths{ 0 };
+    std::uint64_t tail_walks{ 0 };
+    std::uint64_t nodes_walked{ 0 };
+    std::uint64_t longest_walk{ 0 };
+
+    void on_allocate_fresh(std::size_t) noexcept { ++self.fresh_allocations; }
+    void on_allocate_recycled(std::size_t) noexcept { ++self.recycled_allocations; }
+    void on_free(std::size_t) noexcept { ++self.frees; }
+    void on_free_list(std::size_t) noexcept { ++self.list_frees; }
+    void on_growth(std::size_t, std::size_t) noexcept { ++self.growths; }
+    void on_tail_walk(std::size_t walked) noexcept {
+        ++self.tail_walks;
+        self.nodes_walked += walked;
+        if ( walked > self.longest_walk ) {
+            self.longest_walk = walked;
+        }
+    }
+};
+
+
+// Latency histograms of the pool operations, in timestamp ticks (cycles on x86), with power-of-two
+// buckets: bucket b counts the operations that took [2^(b-1), 2^b) ticks.
+// Reading the timestamp costs some cycles itself, so only one operation every Period is timed.
+template <std::uint32_t Period = 64>
+class latency_observer : public no_observer {
+    static_assert( Period > 0, "the sampling period must be positive" );
+
+    public:
+    static constexpr std::size_t buckets{ 64 };
+    using histogram = std::array<std::uint64_t, buckets>;
+
+    struct token {
+        std::uint64_t start;
+    };
+
+    private:
+    static constexpr std::size_t ops{ 4 };
+    std::array<histogram, ops> histograms{};
+    std::uint32_t countdown{ 0 };
+
+    static std::size_t bucket(std::uint64_t ticks) noexcept {
+        std::size_t b{ 0 };
+        while ( ticks > 0 and b + 1 < buckets ) {
+            ticks >>= 1;
+            ++b;
+        }
+        return b;
+    }
+
+    public:
+    // a zero start means that the operation is not sampled
+    token begin(pool_op) noexcept {
+        if ( self.countdown-- != 0 ) {
+            return token{ 0 };
+        }
+        self.countdown = Period - 1;
+        return token{ pool_timestamp() | 1 };
+    }
+    void end(pool_op op, token timing) noexcept {
+        if ( timing.start != 0 ) {
+            ++self.histograms[ std::size_t(op) ][ self.bucket( pool_timestamp() - timing.start ) ];
+        }
+    }
+
+    const histogram& of(pool_op op) const noexcept {
+        return self.histograms[ std::size_t(op) ];
+    }
+    std::uint64_t samples(pool_op op) const noexcept {
+        std::uint64_t total{ 0 };
+        for ( std::uint64_t count : self.of( op ) ) {
+            total += count;
+        }
+        return total;
+    }
+    // an upper bound of the given percentile (0 < p <= 100), in ticks: the top of its bucket
+    std::uint64_t percentile(pool_op op, double p) const noexcept {
+        std::uint64_t total{ self.samples( op ) };
+        std::uint64_t seen{ 0 };
+        for ( std::size_t b{0}; b < buckets; ++b ) {
+            seen += self.of( op )[b];
+            if ( total > 0 and double(seen) >= p / 100.0 * double(total) ) {
+                return std::uint64_t(1) << b;
+            }
+        }
+        return 0;
+    }
+};
+
+
+// Sampled access counting per list, for list_pool::segregate(): one traversal (non-const begin(head)) every Period
+// is counted against its head. The counters are a fixed table of Slots entries indexed by a hash of
+// the head, so counting never allocates and heads colliding in the table share a counter.
+// Heads change with push_front() and free() and all of them change with a relocation, thus the counts
+// are an estimate of the recent past: reset() them after each segregate().
+template <std::uint32_t Period = 16, std::size_t Slots = 4096>
+class access_sampler : public no_observer {
+    static_assert( Period > 0, "the sampling period must be positive" );
+    static_assert( Slots > 0 and ( Slots & (Slots - 1) ) == 0, "the number of slots must be a power of two" );
+
+    std::array<std::uint32_t, Slots> counts{};
+    std::uint32_t countdown{ 0 };
+
+    static std::size_t slot(std::size_t head) noexcept {
+        return std::size_t( ( std::uint64_t(head) * 0x9e3779b97f4a7c15ULL ) >> 32 ) & ( Slots - 1 );
+    }
+
+    public:
+    void on_traverse(std::size_t head) noexcept {
+        if ( self.countdown-- != 0 ) {
+            return;
+        }
+        self.countdown = Period - 1;
+        ++self.counts[ self.slot( head ) ];
+    }
+
+    // the estimated number of traversals of the list starting at head, since the last reset()
+    std::uint64_t heat(std::size_t head) const noexcept {
+        return std::uint64_t( self.counts[ self.slot( head ) ] ) * Period;
+    }
+    void reset() noexcept {
+        self.counts.fill( 0 );
+    }
+};
+
+#undef self
+#endif // __pool_observers_header_guard__
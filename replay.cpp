@@ -0,0 +1,215 @@
+// Replays an operation trace (see operation_trace.hpp) against a pool configuration and reports
+// the throughput, the latency percentiles of each operation and the peak memory of the process.
+// Run it with `make replay TRACE=file`, which tries every configuration, or by hand:
+//
+//   ./replay.x trace [--index 32|64] [--storage vector|chunked] [--value int|string] [--sort-free-list n]
+//   ./replay.x --generate trace [operations]   writes a synthetic trace, for trying the tool out
+//
+// --sort-free-list n switches to the address-ordered free list policy, list_pool::sort_free_list() is called
+// every n operations (the default, 0, is the plain LIFO free_node_list).
+// Each run replays a single configuration, so that the peak memory is the one of that configuration;
+// the growth of the resident set during the replay, that is without the decoded trace, is in parentheses.
+
+#include "list_pool.hpp"
+#include "operation_trace.hpp"
+#include "hdr_histogram.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+
+namespace {
+
+const char* const op_names[]{ "reserve", "push_front", "push_back", "free", "free_list" };
+
+template <typename Value>
+struct make_value;
+
+template <>
+struct make_value<int> {
+    int operator () (std::size_t size) const noexcept { return int(size); }
+};
+template <>
+struct make_value<std::string> {
+    std::string operator () (std::size_t size) const { return std::string( size, 'x' ); }
+};
+
+// the size of a string is what it holds
+struct string_size {
+    std::size_t operator () (const std::string& s) const noexcept { return s.size(); }
+};
+
+// a field of /proc/self/status in KB, VmRSS is the resident set and VmHWM its peak (Linux only)
+long status_kb(const std::string& field) {
+    std::ifstream status{ "/proc/self/status" };
+    std::string line;
+    while ( std::getline( status, line ) ) {
+        if ( line.compare( 0, field.size() + 1, field + ":" ) == 0 ) {
+            return std::strtol( line.c_str() + field.size() + 1, nullptr, 10 );
+        }
+    }
+    return 0;
+}
+// the peak resident set of the process in KB, since the last reset_peak_rss()
+long peak_rss() {
+    long peak{ status_kb( "VmHWM" ) };
+    if ( peak == 0 ) {
+        struct rusage usage;
+        ::getrusage( RUSAGE_SELF, &usage );
+        peak = long( usage.ru_maxrss );
+    }
+    return peak;
+}
+// from now on the peak is the current resident set, so that the decoding of the trace does not count
+void reset_peak_rss() {
+    std::ofstream{ "/proc/self/clear_refs" } << "5";
+}
+
+template <typename Value, typename Index, template<typename> class Storage>
+int replay(const std::vector<trace_record>& records, std::size_t sort_every, const std::string& config) {
+    reset_peak_rss();
+    long before{ status_kb( "VmRSS" ) }; // mostly the decoded trace
+    list_pool<Value, Index, Storage> pool{};
+    std::vector<Index> heads;
+    hdr_histogram histograms[5]{};
+    make_value<Value> value{};
+
+    std::uint64_t start{ pool_timestamp() };
+    std::size_t countdown{ sort_every };
+    for ( const trace_record& record : records ) {
+        if ( sort_every != 0 and --countdown == 0 ) {
+            pool.sort_free_list();
+            countdown = sort_every;
+        }
+        std::uint64_t op_start{ pool_timestamp() };
+        replay_record( pool, heads, record, value );
+        histograms[ std::size_t(record.op) ].record( pool_timestamp() - op_start );
+    }
+    double seconds{ double( pool_timestamp() - start ) * ns_per_tick() * 1e-9 };
+
+    std::printf( "%s: %zu operations, %.2f Mops/s, %zu nodes in use, capacity %zu, peak RSS %ld KB (+%ld KB)\n",
+            config.c_str(), records.size(), double(records.size()) / seconds * 1e-6,
+            std::size_t( pool.size() ), std::size_t( pool.capacity() ), peak_rss(), peak_rss() - before );
+    for ( std::size_t op{0}; op < 5; ++op ) {
+        const hdr_histogram& h{ histograms[op] };
+        if ( h.count() == 0 ) {
+            continue;
+        }
+        std::printf( "  %-10s %10llu ops  p50 %6.0f  p99 %6.0f  p99.9 %7.0f  max %9.0f ns\n", op_names[op],
+                (unsigned long long)( h.count() ), double( h.percentile(50) ) * ns_per_tick(),
+                double( h.percentile(99) ) * ns_per_tick(), double( h.percentile(99.9) ) * ns_per_tick(),
+                double( h.max() ) * ns_per_tick() );
+    }
+    return 0;
+}
+
+template <typename Index, template<typename> class Storage>
+int replay(const std::vector<trace_record>& records, const std::string& value, std::size_t sort_every,
+        const std::string& config) {
+    if ( value == "int" ) {
+        return replay<int, Index, Storage>( records, sort_every, config );
+    }
+    if ( value == "string" ) {
+        return replay<std::string, Index, Storage>( records, sort_every, config );
+    }
+    std::fprintf( stderr, "unknown value type %s\n", value.c_str() );
+    return 2;
+}
+
+// a mix of pushes and frees over a slowly changing set of lists, with strings of a few sizes
+int generate(const std::string& path, std::size_t operations) {
+    std::ofstream os{ path, std::ios::binary };
+    list_pool<std::string, std::uint32_t> pool{};
+    trace_recorder<list_pool<std::string, std::uint32_t>, string_size> recorder{ pool, os };
+    std::vector<std::uint32_t> heads( 4096, pool.new_list() );
+    std::mt19937 random{ 42 };
+    recorder.reserve( operations / 8 );
+    for ( std::size_t i{0}; i < operations; ++i ) {
+        auto& head = heads[ random() % heads.size() ];
+        std::uint32_t dice{ std::uint32_t( random() % 100 ) };
+        if ( dice < 50 ) {
+            head = recorder.push_front( std::string( 8 << (dice % 4), 'x' ), head );
+        } else if ( dice < 60 ) {
+            head = recorder.push_back( std::string( 8, 'x' ), head );
+        } else if ( dice < 99 ) {
+            head = recorder.free( head );
+        } else {
+            head = recorder.free_list( head );
+        }
+    }
+    if ( not os.flush() ) {
+        std::fprintf( stderr, "cannot write %s\n", path.c_str() );
+        return 1;
+    }
+    return 0;
+}
+
+}
+
+
+int main(int argc, char** argv) {
+    if ( argc >= 3 and std::strcmp( argv[1], "--generate" ) == 0 ) {
+        return generate( argv[2], argc >= 4 ? std::size_t( std::strtoull( argv[3], nullptr, 10 ) ) : std::size_t(1) << 22 );
+    }
+    if ( argc < 2 or argc % 2 != 0 ) {
+        std::fprintf( stderr, "usage: %s trace [--index 32|64] [--storage vector|chunked] [--value int|string] [--sort-free-list n]\n"
+                "       %s --generate trace [operations]\n", argv[0], argv[0] );
+        return 2;
+    }
+    std::string index{ "32" }, storage{ "vector" }, value{ "int" };
+    std::size_t sort_every{ 0 };
+    for ( int i{2}; i + 1 < argc; i += 2 ) {
+        std::string option{ argv[i] };
+        if ( option == "--index" ) {
+            index = argv[i + 1];
+        } else if ( option == "--storage" ) {
+            storage = argv[i + 1];
+        } else if ( option == "--value" ) {
+            value = argv[i + 1];
+        } else if ( option == "--sort-free-list" ) {
+            sort_every = std::size_t( std::strtoull( argv[i + 1], nullptr, 10 ) );
+        } else {
+            std::fprintf( stderr, "unknown option %s\n", option.c_str() );
+            return 2;
+        }
+    }
+
+    std::ifstream is{ argv[1], std::ios::binary };
+    if ( not is ) {
+        std::fprintf( stderr, "cannot open %s\n", argv[1] );
+        return 1;
+    }
+    std::vector<trace_record> records;
+    try {
+        records = read_trace( is );
+    } catch (const std::exception& e) {
+        std::fprintf( stderr, "%s: %s\n", argv[1], e.what() );
+        return 1;
+    }
+
+    std::string config{ "index " + index + ", " + storage + " storage, " + value + " values, "
+            + ( sort_every == 0 ? std::string("lifo free list") : "free list sorted every " + std::to_string(sort_every) ) };
+    if ( index == "32" and storage == "vector" ) {
+        return replay<std::uint32_t, vector_storage>( records, value, sort_every, config );
+    }
+    if ( index == "32" and storage == "chunked" ) {
+        return replay<std::uint32_t, chunked_storage>( records, value, sort_every, config );
+    }
+    if ( index == "64" and storage == "vector" ) {
+        return replay<std::uint64_t, vector_storage>( records, value, sort_every, config );
+    }
+    if ( index == "64" and storage == "chunked" ) {
+        return replay<std::uint64_t, chunked_storage>( records, value, sort_every, config );
+    }
+    std::fprintf( stderr, "unknown configuration: %s\n", config.c_str() );
+    return 2;
+}
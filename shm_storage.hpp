@@ -0,0 +1,275 @@
+#ifndef __shm_storage_header_guard__
+#define __shm_storage_header_guard__
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+enum class shm_mode { create, attach };
+
+// A storage for list_pool (see vector_storage) living in a POSIX shared-memory segment, so that
+// one writer process and many reader processes on the same host can share the very same nodes.
+// The writer creates the segment, the readers attach to it read-only and use a const list_pool:
+//
+//   list_pool<int, std::uint32_t, shm_storage> writer{ storage_args, "/lists", shm_mode::create, n };
+//   const list_pool<int, std::uint32_t, shm_storage> reader{ storage_args, "/lists", shm_mode::attach };
+//
+// Nodes refer to each other by index, not by pointer, so the segment works wherever it is mapped.
+// The segment does not grow: its capacity is fixed when it is created and going beyond it throws
+// std::length_error. The free_node_list lives in the writer, readers only need the heads of the lists.
+// The elements are shared as raw bytes, thus they must be trivially copyable.
+//
+// Readers running while the writer mutates the pool must be optimistic, as in concurrent_list_pool.hpp: 
+// the header holds a sequence counter (a seqlock) that the writer bumps around every mutation, 
+//
+//   { shm_storage<...>::write_section section{ writer.storage() }; l = writer.push_front(5, l); }
+//
+// and a reader validates what it read, retrying if a write happened in between: 
+//
+//   do { token = reader.storage().read_begin(); seen.assign(reader.begin(l), reader.end(l)); } 
+//   while ( not reader.storage().read_validate(token) ); 
+//
+// A half-done mutation is harmless to such a reader: nodes never move, the size is published only 
+// after the node is written, and the lists stay acyclic, so a traversal terminates (and is thrown away). 
+// Readers that do not validate must not run while the writer mutates the pool. 
+template <typename T>
+class shm_storage {
+    static_assert( std::is_trivially_copyable<T>::value, "only trivially copyable elements can be shared" );
+
+    public:
+    using size_type = std::size_t;
+    using value_type = T;
+
+    private:
+    // the segment starts with the header, the elements follow (a header is 64 bytes, a cache line)
+    struct header {
+        std::uint64_t magic;
+        std::uint64_t element_size;
+        std::uint64_t capacity;
+        std::atomic<std::uint64_t> size;
+        // odd while a write is in progress
+        std::atomic<std::uint64_t> sequence;
+        char padding[ 64 - 3 * sizeof(std::uint64_t) - 2 * sizeof(std::atomic<std::uint64_t>) ];
+    };
+    static constexpr std::uint64_t magic{ 0x6c697374706f6f6cULL }; // "listpool"
+
+    std::string name;
+    void* base;
+    std::size_t bytes;
+    bool writable;
+
+    [[noreturn]] static void fail(const char* what) {
+        throw std::system_error{ errno, std::generic_category(), what };
+    }
+
+    header& meta() const noexcept {
+        return *static_cast<header*>( self.base );
+    }
+    T* elements() const noexcept {
+        return reinterpret_cast<T*>( static_cast<char*>(self.base) + sizeof(header) );
+    }
+
+    void map(int fd, int protection) {
+        self.base = ::mmap( nullptr, self.bytes, protection, MAP_SHARED, fd, 0 );
+        ::close( fd );
+        if ( self.base == MAP_FAILED ) {
+            self.base = nullptr;
+            self.fail( "cannot map the shared-memory segment" );
+        }
+    }
+
+    void create(size_type capacity) {
+        int fd{ ::shm_open( self.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644 ) };
+        if ( fd < 0 ) {
+            self.fail( "cannot create the shared-memory segment" );
+        }
+        self.bytes = sizeof(header) + capacity * sizeof(T);
+        if ( ::ftruncate( fd, off_t(self.bytes) ) != 0 ) {
+            ::close( fd );
+            ::shm_unlink( self.name.c_str() );
+            self.fail( "cannot size the shared-memory segment" );
+        }
+        self.writable = true;
+        self.map( fd, PROT_READ | PROT_WRITE );
+        header& h{ *::new ( self.base ) header{} };
+        h.magic = magic;
+        h.element_size = sizeof(T);
+        h.capacity = capacity;
+        h.sequence.store( 0, std::memory_order_relaxed );
+        h.size.store( 0, std::memory_order_release );
+    }
+
+    void attach() {
+        int fd{ ::shm_open( self.name.c_str(), O_RDONLY, 0 ) };
+        if ( fd < 0 ) {
+            self.fail( "cannot open the shared-memory segment" );
+        }
+        struct stat info;
+        if ( ::fstat( fd, &info ) != 0 ) {
+            ::close( fd );
+            self.fail( "cannot stat the shared-memory segment" );
+        }
+        self.bytes = std::size_t( info.st_size );
+        if ( self.bytes < sizeof(header) ) {
+            ::close( fd );
+            throw std::runtime_error{ "the shared-memory segment " + self.name + " does not contain a pool" };
+        }
+        self.writable = false;
+        self.map( fd, PROT_READ );
+        if ( self.meta().magic != magic or self.meta().element_size != sizeof(T)
+                or sizeof(header) + self.meta().capacity * sizeof(T) > self.bytes ) {
+            self.release();
+            throw std::runtime_error{ "the shared-memory segment " + self.name + " does not contain a compatible pool" };
+        }
+    }
+
+    // the creator also removes the name, the processes still attached keep their mapping
+    void release() noexcept {
+        if ( self.base != nullptr ) {
+            ::munmap( self.base, self.bytes );
+            if ( self.writable ) {
+                ::shm_unlink( self.name.c_str() );
+            }
+        }
+        self.base = nullptr;
+    }
+
+    public:
+    // create: a new segment, named name (e.g. "/lists"), for capacity elements; it must not exist yet.
+    // attach: map read-only an existing segment, capacity is ignored.
+    shm_storage(std::string name, shm_mode mode, size_type capacity = 0)
+        : name{ std::move(name) },
+        base{ nullptr },
+        bytes{ 0 },
+        writable{ false }
+    {
+        if ( mode == shm_mode::create ) {
+            self.create( capacity );
+        } else {
+            self.attach();
+        }
+    }
+    ~shm_storage() { self.release(); }
+
+    // the mapping is owned, thus the storage can be moved but not copied
+    shm_storage(const shm_storage&) = delete;
+    shm_storage& operator = (const shm_storage&) = delete;
+    shm_storage(shm_storage&& other) noexcept
+        : name{ std::move(other.name) },
+        base{ other.base },
+        bytes{ other.bytes },
+        writable{ other.writable }
+    {
+        other.base = nullptr;
+    }
+    shm_storage& operator = (shm_storage&& rhs) noexcept {
+        std::swap( self.name, rhs.name );
+        std::swap( self.base, rhs.base );
+        std::swap( self.bytes, rhs.bytes );
+        std::swap( self.writable, rhs.writable );
+        return self;
+    }
+
+    // writing through an attached (read-only) segment would crash, readers must use a const list_pool
+    T& operator [] (size_type i) noexcept {
+        return self.elements()[i];
+    }
+    const T& operator [] (size_type i) const noexcept {
+        return self.elements()[i];
+    }
+    const T* data() const noexcept {
+        return self.elements();
+    }
+
+    // the element is fully written before the new size is published to the readers
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        if ( not self.writable ) {
+            throw std::logic_error{ "cannot write to an attached shared-memory segment" };
+        }
+        std::uint64_t n{ self.meta().size.load(std::memory_order_relaxed) };
+        if ( n == self.meta().capacity ) {
+            throw std::length_error{ "the shared-memory segment is full" };
+        }
+        ::new ( static_cast<void*>(self.elements() + n) ) T( std::forward<Args>(args)... );
+        self.meta().size.store( n + 1, std::memory_order_release );
+    }
+
+    // ---- the seqlock of the segment ----
+
+    // brackets a mutation of the pool, only through the segment of the writer (std::logic_error otherwise). 
+    // The storage is const because the writer reaches it through list_pool::storage(), 
+    // the counter lives in the segment and not in this handle. 
+    class write_section {
+        const shm_storage& owner;
+
+        public:
+        explicit write_section(const shm_storage& owner)
+            : owner{ owner }
+        {
+            if ( not owner.writable ) {
+                throw std::logic_error{ "cannot write to an attached shared-memory segment" };
+            }
+            std::atomic<std::uint64_t>& sequence = owner.meta().sequence;
+            sequence.store( sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_release );
+        }
+        ~write_section() {
+            std::atomic<std::uint64_t>& sequence = self.owner.meta().sequence;
+            sequence.store( sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release );
+        }
+        write_section(const write_section&) = delete;
+        write_section& operator = (const write_section&) = delete;
+    };
+
+    // returns the token to be validated at the end of the read; it spins while a write is in progress
+    std::uint64_t read_begin() const noexcept {
+        while (true) {
+            std::uint64_t current{ self.meta().sequence.load(std::memory_order_acquire) };
+            if ( current % 2 == 0 ) {
+                return current;
+            }
+        }
+    }
+    // true if no write happened since read_begin() returned token, i.e., what was read is consistent
+    bool read_validate(std::uint64_t token) const noexcept {
+        std::atomic_thread_fence( std::memory_order_acquire );
+        return ( self.meta().sequence.load(std::memory_order_relaxed) == token );
+    }
+
+    // the capacity is fixed, asking for more than that throws
+    void reserve(size_type n) const {
+        if ( n > self.capacity() ) {
+            throw std::length_error{ "the shared-memory segment cannot grow" };
+        }
+    }
+    size_type size() const noexcept {
+        return size_type( self.meta().size.load(std::memory_order_acquire) );
+    }
+    bool empty() const noexcept {
+        return self.size() == 0;
+    }
+    size_type capacity() const noexcept {
+        return size_type( self.meta().capacity );
+    }
+};
+
+#undef self
+#endif // __shm_storage_header_guard__
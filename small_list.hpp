@@ -0,0 +1,222 @@
+#ifndef __small_list_header_guard__
+#define __small_list_header_guard__
+
+#include "list_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+// A list handle keeping its first K values inline, in the handle itself: most lists are short,
+// and a list of up to K values costs no node and no dependent load through the pool.
+// Past K values the list spills into the pool, the values after the K-th live in a list of Pool
+// (always the full inline part first, then the pooled part), and the iterators go through both.
+// The operations take the pool as an argument, as the handle does not hold it.
+//
+// Like a head of list_pool, the handle does not free its pooled nodes when it is destroyed:
+// call free_list() first. It can be moved but not copied (two copies would share the pooled part).
+// For the same reason there is no move assignment, which could not release the pooled nodes of its target:
+// assign(pool, other) frees them first.
+template <typename Pool, std::size_t K = 3>
+class small_list {
+    static_assert( K > 0 and K < 256, "between 1 and 255 inline values" );
+
+    public:
+    using value_type = typename Pool::value_type;
+    using list_type = typename Pool::list_type;
+
+    private:
+    using Value = value_type;
+    using Index = list_type;
+
+    typename std::aligned_storage<sizeof(Value), alignof(Value)>::type slots[K];
+    Index spilled; // the pooled part, empty unless all the K slots are used
+    std::uint8_t count; // the values in the slots
+
+    Value& at(std::size_t i) noexcept {
+        return *reinterpret_cast<Value*>( &self.slots[i] );
+    }
+    const Value& at(std::size_t i) const noexcept {
+        return *reinterpret_cast<const Value*>( &self.slots[i] );
+    }
+
+    void destroy_inline() noexcept {
+        for ( std::size_t i{0}; i < self.count; ++i ) {
+            self.at(i).~Value();
+        }
+        self.count = 0;
+    }
+
+    // the values and the pooled part of other move here, other is left empty; self must be empty
+    void take(small_list& other) noexcept( std::is_nothrow_move_constructible<Value>::value ) {
+        self.spilled = other.spilled;
+        for ( ; self.count < other.count; ++self.count ) {
+            ::new ( static_cast<void*>(&self.slots[ self.count ]) ) Value( std::move(other.at( self.count )) );
+        }
+        other.destroy_inline();
+        other.spilled = Index( 0 );
+    }
+
+    public:
+    // iterates over the inline values, then over the pooled ones
+    class const_iterator {
+        friend small_list;
+
+        const small_list* list;
+        const Pool* pool;
+        std::size_t position; // in the slots, list->count once in the pooled part
+        Index current; // in the pooled part
+
+        const_iterator(const small_list* list, const Pool* pool, std::size_t position, Index current) noexcept
+            : list{ list },
+            pool{ pool },
+            position{ position },
+            current{ current }
+        {}
+
+        public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Value*;
+        using reference = const Value&;
+
+        reference operator * () const {
+            return self.position < (*self.list).count ? (*self.list).at( self.position ) : (*self.pool).value( self.current );
+        }
+        pointer operator -> () const {
+            return &**this;
+        }
+        const_iterator& operator ++ () {
+            if ( self.position < (*self.list).count ) {
+                ++self.position;
+            } else {
+                self.current = (*self.pool).next( self.current );
+            }
+            return self;
+        }
+        const_iterator operator ++ (int) {
+            const_iterator old{ self };
+            ++self;
+            return old;
+        }
+        bool operator == (const const_iterator& other) const noexcept {
+            return self.position == other.position and self.current == other.current;
+        }
+        bool operator != (const const_iterator& other) const noexcept {
+            return not ( self == other );
+        }
+    };
+
+    explicit small_list(const Pool& pool) noexcept
+        : spilled{ pool.end() },
+        count{ 0 }
+    {}
+    ~small_list() {
+        self.destroy_inline();
+    }
+    small_list(const small_list&) = delete;
+    small_list& operator = (const small_list&) = delete;
+    small_list& operator = (small_list&&) = delete;
+    small_list(small_list&& other) noexcept( std::is_nothrow_move_constructible<Value>::value )
+        : spilled{ Index( 0 ) },
+        count{ 0 }
+    {
+        self.take( other );
+    }
+    // the pooled nodes of the target go back to the pool, then other moves in
+    void assign(Pool& pool, small_list&& other) {
+        if ( &other == &self ) {
+            return;
+        }
+        self.free_list( pool );
+        self.take( other );
+    }
+
+    bool is_empty() const noexcept {
+        return self.count == 0; // the pooled part is used only once the slots are full
+    }
+    // the values kept inline, and whether some live in the pool
+    std::size_t inline_size() const noexcept {
+        return self.count;
+    }
+    bool has_spilled() const noexcept {
+        return self.spilled != Index( 0 );
+    }
+    // the first value, it never needs the pool
+    const Value& front() const {
+        if ( self.is_empty() ) {
+            throw std::out_of_range{ "the small list is empty" };
+        }
+        return self.at(0);
+    }
+
+    void push_front(Pool& pool, Value value) {
+        if ( self.count == K ) {
+            // the last inline value moves to the pool (copied, so that nothing is lost if the pool throws)
+            self.spilled = pool.push_front( static_cast<const Value&>( self.at(K - 1) ), self.spilled );
+            for ( std::size_t i{ K - 1 }; i > 0; --i ) {
+                self.at(i) = std::move( self.at(i - 1) );
+            }
+            self.at(0) = std::move( value );
+            return;
+        }
+        if ( self.count == 0 ) {
+            ::new ( static_cast<void*>(&self.slots[0]) ) Value( std::move(value) );
+        } else {
+            ::new ( static_cast<void*>(&self.slots[ self.count ]) ) Value( std::move(self.at( self.count - 1 )) );
+            for ( std::size_t i{ self.count - 1u }; i > 0; --i ) {
+                self.at(i) = std::move( self.at(i - 1) );
+            }
+            self.at(0) = std::move( value );
+        }
+        ++self.count;
+    }
+    void push_back(Pool& pool, Value value) {
+        if ( self.count < K ) {
+            ::new ( static_cast<void*>(&self.slots[ self.count ]) ) Value( std::move(value) );
+            ++self.count;
+        } else {
+            self.spilled = pool.push_back( std::move(value), self.spilled );
+        }
+    }
+    // removes the first value; the first pooled value, if any, comes back inline
+    void pop_front(Pool& pool) {
+        if ( self.is_empty() ) {
+            return;
+        }
+        for ( std::size_t i{0}; i + 1 < self.count; ++i ) {
+            self.at(i) = std::move( self.at(i + 1) );
+        }
+        if ( self.has_spilled() ) {
+            self.at(K - 1) = std::move( pool.value( self.spilled ) );
+            self.spilled = pool.free( self.spilled );
+        } else {
+            --self.count;
+            self.at( self.count ).~Value();
+        }
+    }
+    void free_list(Pool& pool) {
+        self.spilled = pool.free_list( self.spilled );
+        self.destroy_inline();
+    }
+
+    const_iterator begin(const Pool& pool) const noexcept {
+        return const_iterator{ &self, &pool, 0, self.spilled };
+    }
+    const_iterator end(const Pool& pool) const noexcept {
+        return const_iterator{ &self, &pool, self.count, pool.end() };
+    }
+};
+
+#undef self
+#endif // __small_list_header_guard__
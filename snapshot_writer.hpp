@@ -0,0 +1,172 @@
+#ifndef __snapshot_writer_header_guard__
+#define __snapshot_writer_header_guard__
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// same as in list_pool.hpp
+#define self (*this)
+
+
+struct snapshot_options {
+    // the file is written a block at a time, with blocks aligned in memory to 4096 bytes.
+    // The block size is rounded up to a multiple of 4096.
+    std::size_t block_size = std::size_t(1) << 22;
+    // bypass the page cache; if the file system does not support it, buffered writes are used
+    bool direct_io = false;
+    // called by the writer thread after each block: progress(bytes written so far, total bytes)
+    std::function<void(std::uint64_t, std::uint64_t)> progress;
+};
+
+
+// a streambuf writing to a file descriptor in whole, aligned blocks, as O_DIRECT requires
+class block_file_buf : public std::streambuf {
+    static constexpr std::size_t alignment{ 4096 };
+
+    struct free_deleter {
+        void operator () (char* p) const noexcept { std::free( p ); }
+    };
+
+    int fd;
+    bool direct;
+    std::size_t block;
+    std::unique_ptr<char, free_deleter> buffer;
+    std::uint64_t written;
+    std::uint64_t total;
+    const std::function<void(std::uint64_t, std::uint64_t)>& progress;
+
+    [[noreturn]] static void fail(const char* what) {
+        throw std::system_error{ errno, std::generic_category(), what };
+    }
+
+    void write_all(const char* data, std::size_t size) {
+        while ( size > 0 ) {
+            ssize_t n{ ::write( self.fd, data, size ) };
+            if ( n < 0 ) {
+                if ( errno == EINTR ) {
+                    continue;
+                }
+                self.fail( "cannot write the snapshot" );
+            }
+            data += n;
+            size -= std::size_t( n );
+        }
+    }
+
+    // writes out the buffer, which is a whole block unless this is the last one
+    void flush_block() {
+        std::size_t size{ std::size_t( self.pptr() - self.pbase() ) };
+        if ( size == 0 ) {
+            return;
+        }
+        std::size_t padded{ size };
+        if ( self.direct and size % alignment != 0 ) {
+            // O_DIRECT only writes whole sectors, the padding is cut away by finish()
+            padded = ( size / alignment + 1 ) * alignment;
+            std::memset( self.pbase() + size, 0, padded - size );
+        }
+        self.write_all( self.pbase(), padded );
+        self.written += size;
+        self.setp( self.buffer.get(), self.buffer.get() + self.block );
+        if ( self.progress ) {
+            self.progress( self.written, self.total );
+        }
+    }
+
+    protected:
+    int_type overflow(int_type ch) override {
+        self.flush_block();
+        if ( not traits_type::eq_int_type( ch, traits_type::eof() ) ) {
+            *self.pptr() = traits_type::to_char_type( ch );
+            self.pbump( 1 );
+        }
+        return traits_type::not_eof( ch );
+    }
+
+    public:
+    block_file_buf(int fd, bool direct, std::size_t block_size, std::uint64_t total,
+            const std::function<void(std::uint64_t, std::uint64_t)>& progress)
+        : fd{ fd },
+        direct{ direct },
+        block{ ( block_size + alignment - 1 ) / alignment * alignment },
+        buffer{ nullptr },
+        written{ 0 },
+        total{ total },
+        progress{ progress }
+    {
+        if ( self.block == 0 ) {
+            self.block = alignment;
+        }
+        void* memory{ nullptr };
+        if ( ::posix_memalign( &memory, alignment, self.block ) != 0 ) {
+            throw std::bad_alloc{};
+        }
+        self.buffer.reset( static_cast<char*>(memory) );
+        self.setp( self.buffer.get(), self.buffer.get() + self.block );
+    }
+
+    // writes the last (partial) block, cuts the padding away and makes the file durable
+    std::uint64_t finish() {
+        self.flush_block();
+        if ( self.direct and ::ftruncate( self.fd, off_t(self.written) ) != 0 ) {
+            self.fail( "cannot truncate the snapshot" );
+        }
+        if ( ::fdatasync( self.fd ) != 0 ) {
+            self.fail( "cannot sync the snapshot" );
+        }
+        return self.written;
+    }
+};
+
+
+// Saves pool to path from a dedicated thread, the calling thread only pays for pool.snapshot():
+// O(#chunks) with chunked_storage, whose copy-on-write keeps the mutating threads going at full speed
+// while the frozen view is streamed to disk. With vector_storage the snapshot is a plain copy.
+// The future yields the number of bytes written, or the exception thrown by the writer thread;
+// beware that, as with any std::async future, its destructor waits for the writer to finish.
+template <typename Pool>
+std::future<std::uint64_t> async_save(const Pool& pool, std::string path, snapshot_options options = {}) {
+    std::shared_ptr<const Pool> frozen{ pool.snapshot() };
+    return std::async( std::launch::async, [frozen, path, options]() -> std::uint64_t {
+        bool direct{ options.direct_io };
+        int flags{ O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC };
+        int fd{ ::open( path.c_str(), flags | ( direct ? O_DIRECT : 0 ), 0644 ) };
+        if ( fd < 0 and direct and errno == EINVAL ) {
+            direct = false;
+            fd = ::open( path.c_str(), flags, 0644 );
+        }
+        if ( fd < 0 ) {
+            throw std::system_error{ errno, std::generic_category(), "cannot open the snapshot " + path };
+        }
+        try {
+            block_file_buf buffer{ fd, direct, options.block_size, (*frozen).saved_bytes(), options.progress };
+            std::ostream os{ &buffer };
+            os.exceptions( std::ios::badbit );
+            (*frozen).save( os );
+            std::uint64_t written{ buffer.finish() };
+            ::close( fd );
+            return written;
+        } catch (...) {
+            ::close( fd );
+            throw;
+        }
+    } );
+}
+
+#undef self
+#endif // __snapshot_writer_header_guard__
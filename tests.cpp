@@ -1,7 +1,30 @@
 #include "catch.hpp"
 
+#define COUNT_ALLOCATIONS
+#include "allocation_counter.hpp"
+
 #include "list_pool.hpp"
 #include <algorithm> // max_element, min_element
+#include <cstdio> // remove
+#include <cstring> // memcpy
+#include <fstream>
+#include <numeric> // accumulate
+#include <sstream>
+#include <thread>
+
+#include "concurrent_list_pool.hpp"
+#include "operation_log.hpp"
+#include "shm_storage.hpp"
+#include "snapshot_writer.hpp"
+#include "pool_observers.hpp"
+#include "operation_trace.hpp"
+#include "persistent_list_pool.hpp"
+#include "small_list.hpp"
+#include "multi_list_pool.hpp"
+#include "link_pool.hpp"
+#include "circular_list_pool.hpp"
+
+#include <unistd.h> // getpid
 
 SCENARIO("getting confident with the addresses"){
   list_pool<int, std::size_t> pool{16};
@@ -169,3 +192,1273 @@ SCENARIO("using iterators"){
   }
 
 }
+
+SCENARIO("chunked storage"){
+  GIVEN("a pool whose nodes never move"){
+    list_pool<int, std::size_t, chunked_storage> pool{};
+    auto l = pool.new_list();
+    l = pool.push_front(1, l);
+    const int* first = &pool.value(l);
+
+    WHEN("the pool grows across several chunks"){
+      for (int i = 2; i <= 10000; ++i)
+        l = pool.push_back(i, l);
+
+      THEN("the first node is still where it was"){
+        REQUIRE(&pool.value(l) == first);
+        REQUIRE(*first == 1);
+      }
+      THEN("the lists are the same as with a vector"){
+        REQUIRE(pool.size() == 10000);
+        REQUIRE(*std::max_element(pool.begin(l), pool.end(l)) == 10000);
+        REQUIRE(pool.capacity() >= pool.size());
+      }
+    }
+  }
+  GIVEN("an empty pool"){
+    list_pool<int, std::size_t, chunked_storage> pool{0};
+    THEN("it can be copied and reserved for nothing"){
+      auto copy = pool;
+      copy.reserve(0);
+      REQUIRE(copy.size() == 0);
+      REQUIRE(copy.capacity() == 0);
+    }
+  }
+}
+
+SCENARIO("optimistic readers"){
+  GIVEN("a concurrent pool, a writer and a reader"){
+    using pool_type = concurrent_list_pool<int, std::size_t>::pool_type;
+    concurrent_list_pool<int, std::size_t> pool{};
+    std::atomic<std::size_t> l{pool.new_list()};
+    const int n = 20000;
+
+    // the writer keeps the list equal to k, k+1, ..., n for a decreasing k,
+    // pushing and freeing a temporary node at each step to recycle nodes
+    std::thread writer{[&]{
+      for (int i = n; i > 0; --i)
+        pool.write([&](pool_type& p){
+          l = p.push_front(i, p.free(p.push_front(0, l)));
+        });
+    }};
+
+    std::vector<long> sums;
+    std::thread reader{[&]{
+      for (int i = 0; i < 200; ++i)
+        sums.push_back(pool.read([&](const pool_type& p){
+          long sum = 0, len = 0;
+          for (auto it = p.begin(l); it != p.end(l); ++it, ++len)
+            sum += *it;
+          return sum - (2 * n - len + 1) * len / 2; // 0 for any consistent state
+        }));
+    }};
+    writer.join();
+    reader.join();
+
+    THEN("every validated read saw a consistent list"){
+      for (auto s : sums)
+        REQUIRE(s == 0);
+      auto& p = pool.writer_view();
+      REQUIRE(std::accumulate(p.begin(l), p.end(l), 0L) == long(n) * (n + 1) / 2);
+    }
+  }
+}
+
+SCENARIO("epoch-based reclamation"){
+  GIVEN("a concurrent pool and a pinned reader"){
+    concurrent_list_pool<int, std::size_t> pool{};
+    auto l = pool.new_list();
+    l = pool.push_front(2, l);
+    l = pool.push_front(1, l);
+    auto reader = pool.register_reader();
+
+    WHEN("the writer frees a node the reader is standing on"){
+      auto guard = pool.pin(reader);
+      auto it = pool.pinned_view(guard).begin(l);
+      l = pool.free(l);
+      l = pool.push_front(3, l);
+
+      THEN("the node is not reused while the reader is pinned"){
+        REQUIRE(pool.writer_view().size() == 3);
+        REQUIRE(pool.try_reclaim());
+        REQUIRE(pool.in_limbo() == 1);
+        REQUIRE(*it == 1);
+        REQUIRE(*++it == 2);
+      }
+    }
+
+    WHEN("the reader stays pinned while the epoch moves on"){
+      auto guard = pool.pin(reader);
+      l = pool.free(l);
+      REQUIRE(pool.try_reclaim());
+
+      THEN("the pool cannot reclaim until the reader lets go"){
+        REQUIRE_FALSE(pool.try_reclaim());
+        REQUIRE_FALSE(pool.try_reclaim());
+        REQUIRE(pool.in_limbo() == 1);
+        { auto released = std::move(guard); }
+        REQUIRE(pool.try_reclaim());
+        REQUIRE(pool.try_reclaim());
+        REQUIRE(pool.in_limbo() == 0);
+      }
+    }
+
+    WHEN("the reader is gone"){
+      l = pool.free(l);
+      pool.unregister_reader(reader);
+
+      THEN("the node is reused once two epochs have passed"){
+        REQUIRE(pool.try_reclaim());
+        REQUIRE(pool.try_reclaim());
+        REQUIRE(pool.in_limbo() == 0);
+        l = pool.push_front(3, l);
+        REQUIRE(pool.writer_view().size() == 2);
+      }
+    }
+  }
+}
+
+SCENARIO("epoch-based reclamation with concurrent readers"){
+  GIVEN("a writer recycling nodes and pinned readers walking the list"){
+    concurrent_list_pool<int, std::uint32_t> pool{1000, 4};
+    REQUIRE(pool.writer_view().capacity() >= 1000);
+    std::atomic<std::uint32_t> head{pool.new_list()};
+    std::atomic<bool> done{false};
+    const int n = 200000;
+
+    // the values of the list always decrease from its head: a node reused under a reader
+    // would show up as a value greater than the one before it
+    std::atomic<long> walks{0}, violations{0};
+    std::thread writer{[&]{
+      while (walks == 0) std::this_thread::yield(); // the readers are on their way
+      auto l = pool.new_list();
+      int length = 0;
+      for (int i = 1; i <= n; ++i) {
+        // the readers unpin between walks, so the epoch always gets to move on
+        if (i % 64 == 0)
+          while (not pool.try_reclaim()) std::this_thread::yield();
+        l = pool.push_front(i, l);
+        ++length;
+        if (i % 3 == 0) {
+          l = pool.free(l);
+          --length;
+        }
+        if (length == 64) {
+          l = pool.free_list(l);
+          length = 0;
+        }
+        head.store(l, std::memory_order_release);
+      }
+      done = true;
+    }};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r)
+      readers.emplace_back([&]{
+        auto reader = pool.register_reader();
+        while (not done) {
+          auto guard = pool.pin(reader);
+          const auto& p = pool.pinned_view(guard);
+          auto l = head.load(std::memory_order_acquire);
+          int previous = n + 1, length = 0;
+          for (auto it = p.begin(l); it != p.end(l); ++it, ++length) {
+            if (*it >= previous or length > 64) {
+              ++violations;
+              break;
+            }
+            previous = *it;
+          }
+          ++walks;
+          std::this_thread::yield(); // unpinned for a moment, so that the writer can reclaim
+        }
+        pool.unregister_reader(reader);
+      });
+    writer.join();
+    for (auto& reader : readers) reader.join();
+
+    THEN("no reader saw a reused node, and the nodes were reused"){
+      REQUIRE(violations == 0);
+      REQUIRE(walks > 0);
+      REQUIRE(pool.writer_view().size() < std::uint32_t(n / 100));
+      REQUIRE(pool.try_reclaim());
+      REQUIRE(pool.try_reclaim());
+      REQUIRE(pool.in_limbo() == 0);
+    }
+  }
+}
+
+SCENARIO("copy-on-write snapshots"){
+  GIVEN("a pool spanning a few chunks"){
+    list_pool<int, std::size_t, chunked_storage> pool{};
+    auto l1 = pool.new_list();
+    auto l2 = pool.new_list();
+    for (int i = 0; i < 10000; ++i)
+      l1 = pool.push_front(i, l1);
+    l2 = pool.push_front(-1, l2);
+
+    WHEN("we take a snapshot and keep writing"){
+      auto snapshot = pool.snapshot();
+      REQUIRE(snapshot->size() == pool.size());
+
+      l2 = pool.free_list(l2);
+      pool.value(l1) = 42;
+      l1 = pool.push_front(10000, l1);
+
+      THEN("the snapshot still sees the old state"){
+        REQUIRE(snapshot->value(10000) == 9999);
+        REQUIRE(snapshot->value(10001) == -1);
+        REQUIRE(snapshot->size() == 10001);
+        REQUIRE(*std::max_element(snapshot->begin(10000), snapshot->end(10000)) == 9999);
+      }
+      THEN("the live pool sees the new one"){
+        REQUIRE(pool.value(pool.next(l1)) == 42);
+        REQUIRE(l1 == 10001); // the node of l2 has been reused
+      }
+    }
+
+    WHEN("threads read a snapshot while the pool keeps writing"){
+      std::shared_ptr<const list_pool<int, std::size_t, chunked_storage>> snapshot = pool.snapshot();
+      std::vector<long> sums(2, 0);
+      const auto head = l1;
+      std::vector<std::thread> readers;
+      for (std::size_t r = 0; r < sums.size(); ++r)
+        readers.emplace_back([&, r]{
+          for (int round = 0; round < 20; ++round) {
+            sums[r] += std::accumulate(snapshot->begin(head), snapshot->end(head), 0L);
+            for (auto index = head; not snapshot->is_empty(index); index = snapshot->next(index))
+              sums[r] -= snapshot->value(index);
+          }
+        });
+      for (int i = 0; i < 10000; ++i)
+        l1 = pool.push_front(pool.value(l1) + 1, pool.free(l1));
+      for (auto& reader : readers) reader.join();
+
+      THEN("they only read: the snapshot is intact, there is no race (run under -fsanitize=thread)"){
+        REQUIRE(sums == std::vector<long>(2, 0));
+        REQUIRE(std::accumulate(snapshot->begin(10000), snapshot->end(10000), 0L) == 9999L * 10000 / 2);
+        REQUIRE(pool.value(l1) == 19999);
+      }
+    }
+  }
+
+  GIVEN("the chunked storage itself"){
+    chunked_vector<int> storage{};
+    for (int i = 0; i < 10000; ++i)
+      storage.emplace_back(i);
+
+    WHEN("we copy it and write to one element"){
+      auto copy = storage;
+      REQUIRE(storage.shared_chunks() == 3);
+      storage[0] = 42;
+
+      THEN("only the chunk that has been written was cloned"){
+        REQUIRE(storage.shared_chunks() == 2);
+        REQUIRE(copy.shared_chunks() == 2);
+        REQUIRE(copy[0] == 0);
+        REQUIRE(storage[0] == 42);
+      }
+    }
+  }
+}
+
+SCENARIO("saving and checkpointing"){
+  GIVEN("a pool with some lists"){
+    list_pool<int, std::size_t, chunked_storage> pool{};
+    auto l1 = pool.new_list();
+    auto l2 = pool.new_list();
+    for (int i = 0; i < 10000; ++i)
+      l1 = pool.push_front(i, l1);
+    l2 = pool.push_back(-1, l2);
+    l2 = pool.push_back(-2, l2);
+
+    WHEN("we save and load it"){
+      std::stringstream file;
+      pool.save(file);
+      list_pool<int, std::size_t> loaded{};
+      loaded.load(file);
+
+      THEN("we get the same lists back, with the same indices"){
+        REQUIRE(std::equal(pool.begin(l1), pool.end(l1), loaded.begin(l1)));
+        REQUIRE(loaded.value(loaded.next(l2)) == -2);
+      }
+    }
+
+    WHEN("we checkpoint it and then save only the deltas"){
+      std::stringstream base, delta1, delta2;
+      pool.checkpoint(base);
+
+      l2 = pool.free(l2);
+      pool.checkpoint_delta(delta1);
+
+      for (int i = 0; i < 5000; ++i)
+        l2 = pool.push_front(i, l2);
+      pool.value(l1) = 42;
+      pool.checkpoint_delta(delta2);
+
+      THEN("the deltas are much smaller than the base"){
+        REQUIRE(delta1.str().size() * 2 < base.str().size());
+      }
+      THEN("base and deltas restore the pool"){
+        list_pool<int, std::size_t, chunked_storage> restored{};
+        restored.restore(base, delta1, delta2);
+        REQUIRE(restored.size() == pool.size());
+        REQUIRE(std::equal(pool.begin(l1), pool.end(l1), restored.begin(l1)));
+        REQUIRE(std::equal(pool.begin(l2), pool.end(l2), restored.begin(l2)));
+
+        // the free_node_list is restored as well
+        REQUIRE(restored.push_front(7, restored.new_list()) == pool.push_front(7, pool.new_list()));
+      }
+    }
+
+    WHEN("we only read between two checkpoints"){
+      std::stringstream base, nothing, read_only;
+      pool.checkpoint(base);
+      pool.checkpoint_delta(nothing);
+
+      const auto& view = pool;
+      long sum = std::accumulate(view.cbegin(l1), view.cend(l1), 0L);
+      for (auto index = l2; not view.is_empty(index); index = view.next(index))
+        sum += view.value(index);
+      pool.checkpoint_delta(read_only);
+
+      THEN("the delta holds no chunk"){
+        REQUIRE(sum == 9999L * 10000 / 2 - 3);
+        REQUIRE(read_only.str().size() == nothing.str().size());
+      }
+      THEN("a pool loaded from the checkpoint starts clean"){
+        list_pool<int, std::size_t, chunked_storage> loaded{};
+        loaded.load(base);
+        std::stringstream delta;
+        loaded.checkpoint_delta(delta);
+        REQUIRE(delta.str().size() == nothing.str().size());
+      }
+    }
+
+    WHEN("we load something that is not a pool"){
+      std::stringstream file{"definitely not a pool, but long enough to fill a header"};
+      THEN("an exception is thrown")
+        REQUIRE_THROWS_AS(pool.load(file), std::runtime_error);
+    }
+  }
+}
+
+SCENARIO("write-ahead log"){
+  GIVEN("a pool logging its operations"){
+    const char* path = "tests_wal.log";
+    std::remove(path);
+    list_pool<int, std::size_t, vector_storage, write_ahead_log> pool{};
+    auto l1 = pool.new_list();
+    l1 = pool.push_front(1, l1);
+
+    std::stringstream snapshot;
+    pool.save(snapshot);
+    pool.operation_log().open(path, 4);
+
+    l1 = pool.push_front(2, l1);
+    l1 = pool.push_back(3, l1);
+    auto l2 = pool.push_back(4, pool.new_list());
+    l2 = pool.push_front(5, l2);
+    l1 = pool.free(l1);
+    l2 = pool.free_list(l2);
+    l2 = pool.push_front(6, l2);
+    pool.operation_log().commit();
+
+    WHEN("we crash and recover from the snapshot and the log"){
+      list_pool<int, std::size_t> recovered{};
+      recovered.load(snapshot);
+      auto replayed = write_ahead_log::replay(path, recovered);
+
+      THEN("the recovered pool is identical"){
+        REQUIRE(replayed == 7);
+        REQUIRE(std::equal(pool.begin(l1), pool.end(l1), recovered.begin(l1), recovered.end(l1)));
+        REQUIRE(std::equal(pool.begin(l2), pool.end(l2), recovered.begin(l2), recovered.end(l2)));
+        REQUIRE(recovered.push_front(0, 0) == pool.push_front(0, 0));
+      }
+    }
+    WHEN("the log cannot be written"){
+      pool.operation_log().open("/dev/full", 1); // every write fails with ENOSPC
+      auto before = pool.memory_report();
+      std::vector<int> l1_before(pool.begin(l1), pool.end(l1));
+
+      THEN("the operations throw and do not happen, nothing leaks"){
+        REQUIRE_THROWS_AS(pool.push_front(7, l1), std::system_error);
+        REQUIRE_THROWS_AS(pool.push_back(8, l1), std::system_error);
+        REQUIRE_THROWS_AS(pool.push_back(9, pool.new_list()), std::system_error);
+        REQUIRE_THROWS_AS(pool.free(l1), std::system_error);
+        REQUIRE_THROWS_AS(pool.free_list(l1), std::system_error);
+        REQUIRE(std::vector<int>(pool.begin(l1), pool.end(l1)) == l1_before);
+        REQUIRE(pool.memory_report().live_nodes == before.live_nodes);
+      }
+      AND_WHEN("the log can be written again"){
+        REQUIRE_THROWS_AS(pool.push_front(7, l1), std::system_error);
+        pool.operation_log().open(path, 1);
+        l1 = pool.push_front(7, l1);
+        list_pool<int, std::size_t> recovered{};
+        recovered.load(snapshot);
+        THEN("the log holds the operations that happened, and only those"){
+          REQUIRE(write_ahead_log::replay(path, recovered) == 8);
+          REQUIRE(std::equal(pool.begin(l1), pool.end(l1), recovered.begin(l1), recovered.end(l1)));
+        }
+      }
+    }
+    pool.operation_log().close();
+    std::remove(path);
+  }
+}
+
+SCENARIO("shared-memory pools"){
+  GIVEN("a writer creating a segment and a reader attached to it"){
+    const std::string name = "/list_pool_tests_" + std::to_string(::getpid());
+    list_pool<int, std::uint32_t, shm_storage> writer{storage_args, name, shm_mode::create, 100};
+    const list_pool<int, std::uint32_t, shm_storage> reader{storage_args, name, shm_mode::attach};
+
+    auto l = writer.new_list();
+    l = writer.push_front(3, l);
+    l = writer.push_front(2, l);
+    l = writer.push_back(4, l);
+    l = writer.push_front(1, l);
+
+    THEN("the reader sees the lists through its own mapping"){
+      REQUIRE(&reader.value(l) != &writer.value(l));
+      std::vector<int> seen(reader.begin(l), reader.end(l));
+      REQUIRE(seen == std::vector<int>{1, 2, 3, 4});
+    }
+
+    THEN("the reader cannot write and the writer cannot grow"){
+      REQUIRE(reader.capacity() == 100);
+      REQUIRE_THROWS_AS(writer.reserve(101), std::length_error);
+      for (int i = 4; i < 100; ++i)
+        l = writer.push_front(i, l);
+      REQUIRE_THROWS_AS(writer.push_front(100, l), std::length_error);
+    }
+
+    THEN("the writer bumps the sequence counter of the segment around its mutations"){
+      using write_section = std::decay<decltype(writer.storage())>::type::write_section;
+      auto token = reader.storage().read_begin();
+      std::vector<int> seen(reader.begin(l), reader.end(l));
+      REQUIRE(reader.storage().read_validate(token));
+      {
+        write_section section{writer.storage()};
+        REQUIRE_FALSE(reader.storage().read_validate(token));
+        l = writer.push_front(0, l);
+      }
+      REQUIRE_FALSE(reader.storage().read_validate(token));
+      token = reader.storage().read_begin();
+      seen.assign(reader.begin(l), reader.end(l));
+      REQUIRE(reader.storage().read_validate(token));
+      REQUIRE(seen == std::vector<int>{0, 1, 2, 3, 4});
+      REQUIRE_THROWS_AS(write_section{reader.storage()}, std::logic_error);
+    }
+
+    THEN("the segment can be saved and loaded back into a pool of the heap"){
+      std::stringstream file;
+      reader.save(file);
+      list_pool<int, std::uint32_t> loaded;
+      loaded.load(file);
+      std::vector<int> seen(loaded.begin(l), loaded.end(l));
+      REQUIRE(seen == std::vector<int>{1, 2, 3, 4});
+      REQUIRE(loaded.size() == writer.size());
+    }
+  }
+}
+
+SCENARIO("asynchronous snapshots"){
+  GIVEN("a pool being written to disk by a background thread"){
+    const char* path = "tests_snapshot.bin";
+    list_pool<int, std::size_t, chunked_storage> pool{};
+    auto l = pool.new_list();
+    for (int i = 0; i < 20000; ++i)
+      l = pool.push_front(i, l);
+    auto saved = l;
+
+    snapshot_options options;
+    options.block_size = 16384;
+    options.direct_io = true;
+    // the callback runs on the writer thread, Catch assertions must stay on this one
+    std::uint64_t last_progress = 0, total_bytes = 0;
+    options.progress = [&](std::uint64_t written, std::uint64_t total){
+      last_progress = written;
+      total_bytes = total;
+    };
+    auto done = async_save(pool, path, options);
+
+    WHEN("the pool keeps changing in the meantime"){
+      l = pool.free_list(l);
+      for (int i = 0; i < 1000; ++i)
+        l = pool.push_front(-i, l);
+      auto written = done.get();
+
+      THEN("the file holds the pool as it was when the save started"){
+        REQUIRE(written == last_progress);
+        REQUIRE(written == total_bytes);
+        std::ifstream file{path, std::ios::binary};
+        list_pool<int, std::size_t> loaded{};
+        loaded.load(file);
+        REQUIRE(loaded.size() == 20000);
+        REQUIRE(loaded.value(saved) == 19999);
+        REQUIRE(std::accumulate(loaded.begin(saved), loaded.end(saved), 0L) == 19999L * 20000 / 2);
+      }
+    }
+    std::remove(path);
+  }
+}
+
+SCENARIO("compressed format"){
+  GIVEN("a pool with some lists and some free nodes"){
+    list_pool<int, std::size_t> pool{};
+    std::vector<std::size_t> heads(3, pool.new_list());
+    for (int i = 0; i < 1000; ++i)
+      heads[i % 3] = pool.push_front(i % 100 - 50, heads[i % 3]);
+    auto garbage = pool.push_front(7, pool.new_list());
+    garbage = pool.push_front(8, garbage);
+    pool.free_list(garbage);
+    heads.push_back(pool.new_list()); // an empty list is a list too
+
+    WHEN("we save it compressed and load it back"){
+      std::stringstream raw, compressed;
+      pool.save(raw);
+      pool.save_compressed(compressed, heads, list_pool_codec::varint{});
+      list_pool<int, std::size_t> loaded{};
+      auto loaded_heads = loaded.load_compressed(compressed, list_pool_codec::varint{});
+
+      THEN("the lists are back at the same indices"){
+        REQUIRE(loaded_heads == heads);
+        for (auto head : heads)
+          REQUIRE(std::equal(pool.begin(head), pool.end(head), loaded.begin(head), loaded.end(head)));
+      }
+      THEN("the free nodes are reused"){
+        REQUIRE(loaded.size() == pool.size());
+        auto l = loaded.push_front(0, loaded.new_list());
+        REQUIRE(l == 1001);
+      }
+      THEN("it is much smaller than the raw format"){
+        REQUIRE(compressed.str().size() * 4 < raw.str().size());
+      }
+    }
+
+    WHEN("two lists share their tail"){
+      auto other = pool.push_front(42, heads[0]);
+      heads.push_back(pool.push_front(43, heads[0]));
+      heads.push_back(other);
+      std::stringstream compressed;
+      THEN("saving them is rejected before anything is written"){
+        REQUIRE_THROWS_AS(pool.save_compressed(compressed, heads), std::invalid_argument);
+        REQUIRE(compressed.str().empty());
+      }
+    }
+
+    WHEN("the header claims more nodes than the stream holds"){
+      std::stringstream compressed;
+      pool.save_compressed(compressed, heads);
+      std::string bytes = compressed.str();
+      // the size of the pool is in the header, before the bitmap
+      std::uint64_t size = pool.size();
+      auto at = bytes.find(std::string(reinterpret_cast<const char*>(&size), sizeof(size)));
+      REQUIRE(at < 64);
+      list_pool<int, std::size_t> loaded{};
+      THEN("loading it fails before the nodes are allocated"){
+        for (std::uint64_t claimed : {std::uint64_t(1) << 40, ~std::uint64_t(0), std::uint64_t(size + 8 * bytes.size())}) {
+          std::memcpy(&bytes[at], &claimed, sizeof(claimed));
+          std::stringstream corrupted(bytes);
+          REQUIRE_THROWS_AS(loaded.load_compressed(corrupted), std::runtime_error);
+        }
+      }
+    }
+
+    WHEN("the lists span several blocks"){
+      for (int i = 0; i < 5000; ++i)
+        heads[i % 2] = pool.push_front(i, heads[i % 2]);
+      std::stringstream compressed;
+      pool.save_compressed(compressed, heads);
+      list_pool<int, std::size_t> loaded{};
+      auto loaded_heads = loaded.load_compressed(compressed);
+      THEN("they come back whole"){
+        REQUIRE(loaded_heads == heads);
+        for (auto head : heads)
+          REQUIRE(std::equal(pool.begin(head), pool.end(head), loaded.begin(head), loaded.end(head)));
+        REQUIRE(loaded.size() == pool.size());
+      }
+    }
+
+    WHEN("the count of lists is corrupted"){
+      // no list at all: the header, then a count of 0 in a single byte
+      std::stringstream nothing;
+      pool.save_compressed(nothing, std::vector<std::size_t>{});
+      std::string bytes = nothing.str();
+      bytes.pop_back();
+      bytes += std::string(8, '\xff') + '\x7f' + std::string(16, '\0'); // 2^63 - 1 lists
+      std::stringstream corrupted(bytes);
+      list_pool<int, std::size_t> loaded{};
+      THEN("loading it fails before the heads are allocated"){
+        REQUIRE_THROWS_AS(loaded.load_compressed(corrupted), std::runtime_error);
+      }
+    }
+  }
+}
+
+SCENARIO("Arrow export and import"){
+  GIVEN("a pool with a few lists"){
+    list_pool<int, std::size_t> pool{};
+    std::vector<std::size_t> heads(4, pool.new_list());
+    for (int i = 0; i < 100; ++i)
+      heads[i % 3] = pool.push_front(i, heads[i % 3]);
+
+    WHEN("we export them"){
+      alignas(64) std::int64_t offsets[5];
+      alignas(64) int values[100];
+      auto total = pool.arrow_offsets(heads, offsets, 2);
+      pool.export_arrow(heads, offsets, values, 2);
+
+      THEN("we get an Arrow ListArray layout"){
+        REQUIRE(total == 100);
+        REQUIRE(offsets[0] == 0);
+        REQUIRE(offsets[1] == 34);
+        REQUIRE(offsets[3] == 100);
+        REQUIRE(offsets[4] == 100); // the empty list
+        REQUIRE(std::equal(pool.begin(heads[1]), pool.end(heads[1]), values + offsets[1], values + offsets[2]));
+      }
+      THEN("we can import them back as contiguous lists"){
+        list_pool<int, std::uint16_t> imported{};
+        auto imported_heads = imported.import_arrow(offsets, 4, values, 100);
+        REQUIRE(imported.size() == 100);
+        REQUIRE(imported_heads[0] == 1);
+        REQUIRE(imported_heads[1] == 35);
+        REQUIRE(imported.is_empty(imported_heads[3]));
+        for (int i = 0; i < 4; ++i)
+          REQUIRE(std::equal(pool.begin(heads[i]), pool.end(heads[i]), imported.begin(imported_heads[i]), imported.end(imported_heads[i])));
+      }
+      THEN("misaligned buffers are rejected")
+        REQUIRE_THROWS_AS(pool.export_arrow(heads, offsets, values + 1), std::invalid_argument);
+      THEN("invalid heads are rejected by the export too"){
+        std::vector<std::size_t> invalid{heads[0], pool.size() + 1};
+        REQUIRE_THROWS_AS(pool.export_arrow(invalid, offsets, values), std::invalid_argument);
+      }
+      THEN("invalid offsets are rejected before anything is imported"){
+        list_pool<int, std::uint16_t> imported{};
+        REQUIRE_THROWS_AS(imported.import_arrow(offsets, 4, values, 99), std::invalid_argument);
+        offsets[2] = 10; // below offsets[1]
+        REQUIRE_THROWS_AS(imported.import_arrow(offsets, 4, values, 100), std::invalid_argument);
+        REQUIRE(imported.size() == 0);
+        REQUIRE(imported.capacity() == 0);
+      }
+    }
+  }
+}
+
+SCENARIO("observing the pool"){
+  GIVEN("a pool with counters"){
+    list_pool<int, std::size_t, vector_storage, no_log, counting_observer> pool{};
+    auto l = pool.new_list();
+    for (int i = 0; i < 4; ++i)
+      l = pool.push_back(i, l);
+    l = pool.free(l);
+    l = pool.push_front(0, l);
+    l = pool.free_list(l);
+
+    THEN("every event has been counted"){
+      const auto& counters = pool.observer();
+      REQUIRE(counters.fresh_allocations == 4);
+      REQUIRE(counters.recycled_allocations == 1);
+      REQUIRE(counters.frees == 1);
+      REQUIRE(counters.list_frees == 1);
+      REQUIRE(counters.growths >= 1);
+      REQUIRE(counters.tail_walks == 4); // three push_back on a non-empty list and a free_list
+      REQUIRE(counters.nodes_walked == 0 + 1 + 2 + 3);
+      REQUIRE(counters.longest_walk == 3);
+    }
+  }
+
+  GIVEN("a pool with counters whose log cannot be written"){
+    list_pool<int, std::size_t, vector_storage, write_ahead_log, counting_observer> pool{};
+    auto l = pool.push_front(1, pool.new_list());
+    l = pool.free(l);
+    pool.operation_log().open("/dev/full", 1); // every write fails with ENOSPC
+
+    THEN("the pushes that did not happen are not counted"){
+      REQUIRE_THROWS_AS(pool.push_front(2, l), std::system_error);
+      REQUIRE_THROWS_AS(pool.push_back(3, pool.new_list()), std::system_error);
+      REQUIRE(pool.observer().fresh_allocations == 1);
+      REQUIRE(pool.observer().recycled_allocations == 0);
+    }
+    pool.operation_log().close();
+  }
+
+  GIVEN("a pool with latency histograms"){
+    list_pool<int, std::size_t, vector_storage, no_log, latency_observer<1>> pool{};
+    auto l = pool.new_list();
+    for (int i = 0; i < 100; ++i)
+      l = pool.push_front(i, l);
+
+    THEN("every operation has been timed"){
+      REQUIRE(pool.observer().samples(pool_op::push_front) == 100);
+      REQUIRE(pool.observer().samples(pool_op::free) == 0);
+      REQUIRE(pool.observer().percentile(pool_op::push_front, 50) <= pool.observer().percentile(pool_op::push_front, 100));
+    }
+  }
+}
+
+SCENARIO("recording and replaying operations"){
+  GIVEN("a pool whose operations are traced"){
+    list_pool<int, std::size_t> pool{};
+    std::stringstream trace;
+    trace_recorder<list_pool<int, std::size_t>> recorder{pool, trace};
+    std::vector<std::size_t> heads(3, recorder.new_list());
+    recorder.reserve(16);
+    for (int i = 0; i < 30; ++i)
+      heads[i % 3] = (i % 4 == 0) ? recorder.push_back(i, heads[i % 3]) : recorder.push_front(i, heads[i % 3]);
+    heads[0] = recorder.free(heads[0]);
+    heads[1] = recorder.free_list(heads[1]);
+    heads[1] = recorder.push_front(99, heads[1]); // a new list, which reuses the id of the freed one
+
+    WHEN("we replay the trace against another configuration"){
+      list_pool<int, std::uint16_t, chunked_storage> replayed{};
+      auto replayed_heads = replay_trace(trace, replayed, [](std::size_t size){ return int(size); });
+
+      THEN("it has the same lists, with values of the recorded size"){
+        REQUIRE(replayed_heads.size() == 3);
+        REQUIRE(replayed.size() == pool.size());
+        REQUIRE(replayed.capacity() >= 16);
+        std::vector<std::size_t> lengths, replayed_lengths;
+        for (auto head : heads)
+          lengths.push_back(std::distance(pool.begin(head), pool.end(head)));
+        for (auto head : replayed_heads)
+          replayed_lengths.push_back(std::distance(replayed.begin(head), replayed.end(head)));
+        REQUIRE(lengths == replayed_lengths);
+        REQUIRE(*replayed.begin(replayed_heads[1]) == int(sizeof(int)));
+      }
+    }
+    THEN("a node in the middle of a list is not a list")
+      REQUIRE_THROWS_AS(recorder.free(pool.next(heads[2])), std::invalid_argument);
+    THEN("a truncated trace is rejected"){
+      std::stringstream truncated{trace.str().substr(0, trace.str().size() - 1)};
+      list_pool<int, std::size_t> replayed{};
+      REQUIRE_THROWS_AS(replay_trace(truncated, replayed, [](std::size_t){ return 0; }), std::runtime_error);
+    }
+  }
+}
+
+SCENARIO("churning without allocating"){
+  GIVEN("a pool with all the nodes it needs"){
+    list_pool<int, std::uint32_t, chunked_storage> pool{1000};
+    std::vector<std::uint32_t> heads(10, pool.new_list());
+
+    WHEN("lists grow and shrink within its capacity"){
+      allocation_count allocations{};
+      for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 1000; ++i)
+          heads[i % 10] = pool.push_front(i, heads[i % 10]);
+        for (int i = 0; i < 500; ++i)
+          heads[i % 10] = pool.free(heads[i % 10]);
+        for (auto& head : heads)
+          head = pool.free_list(head);
+      }
+      auto allocated = allocations();
+      THEN("the heap is never touched")
+        REQUIRE(allocated == 0);
+    }
+    WHEN("it grows beyond its capacity"){
+      allocation_count allocations{};
+      for (int i = 0; i < 10000; ++i)
+        heads[0] = pool.push_front(i, heads[0]);
+      auto allocated = allocations();
+      THEN("the allocations are counted")
+        REQUIRE(allocated > 0);
+    }
+  }
+}
+
+SCENARIO("defragmenting the pool"){
+  GIVEN("lists whose nodes are scattered by churn, and a leaked node"){
+    list_pool<int, std::uint32_t, chunked_storage> pool{};
+    std::vector<std::uint32_t> heads(3, pool.new_list());
+    for (int i = 0; i < 300; ++i)
+      heads[i % 3] = pool.push_front(i, heads[i % 3]);
+    for (int i = 0; i < 50; ++i)
+      heads[i % 2] = pool.free(heads[i % 2]);
+    pool.push_front(-1, pool.new_list()); // nobody holds its head
+    std::vector<std::vector<int>> before;
+    for (auto head : heads)
+      before.emplace_back(pool.begin(head), pool.end(head));
+    auto frozen = pool.snapshot();
+
+    WHEN("we sort the free list"){
+      pool.sort_free_list();
+      THEN("the free nodes are recycled in increasing order"){
+        auto a = pool.push_front(0, pool.new_list());
+        auto b = pool.push_front(0, pool.new_list());
+        REQUIRE(a < b);
+        REQUIRE(std::equal(before[2].begin(), before[2].end(), pool.begin(heads[2])));
+      }
+    }
+    WHEN("we compact it"){
+      auto old_heads = heads;
+      pool.compact(heads);
+      THEN("each list is contiguous, in traversal order, at the front"){
+        REQUIRE(heads[0] == 1);
+        REQUIRE(heads[1] == 1 + before[0].size());
+        for (auto head : heads) {
+          auto index = head;
+          for (auto next = pool.next(index); next != pool.end(); index = next, next = pool.next(index))
+            REQUIRE(next == index + 1);
+        }
+      }
+      THEN("the lists are the same"){
+        for (int i = 0; i < 3; ++i)
+          REQUIRE(std::equal(before[i].begin(), before[i].end(), pool.begin(heads[i]), pool.end(heads[i])));
+      }
+      THEN("the free nodes, the leaked one too, come next in order"){
+        REQUIRE(pool.push_front(0, pool.new_list()) == 251);
+        REQUIRE(pool.push_front(0, pool.new_list()) == 252);
+      }
+      THEN("a snapshot taken before is untouched"){
+        for (int i = 0; i < 3; ++i)
+          REQUIRE(std::equal(before[i].begin(), before[i].end(), frozen->begin(old_heads[i]), frozen->end(old_heads[i])));
+      }
+    }
+  }
+}
+
+SCENARIO("accounting for memory"){
+  GIVEN("a pool of strings shared by two tenants"){
+    list_pool<std::string, std::uint32_t> pool{16};
+    auto small = pool.new_list(), big = pool.new_list();
+    for (int i = 0; i < 3; ++i)
+      small = pool.push_front("x", small);
+    for (int i = 0; i < 5; ++i)
+      big = pool.push_front(std::string(100, 'y'), big);
+    pool.free(pool.push_front(std::string(200, 'z'), pool.new_list()));
+
+    THEN("each list is charged for its nodes and for its strings"){
+      REQUIRE(pool.length(small) == 3);
+      REQUIRE(pool.length(big) == 5);
+      auto node = pool.memory_usage(small) / 3;
+      REQUIRE(node >= sizeof(std::string));
+      REQUIRE(pool.memory_usage(big) >= 5 * (node + 101));
+      REQUIRE(pool.memory_usage(big, [](const std::string&){ return std::size_t(0); }) == 5 * node);
+    }
+    THEN("the pool is split into live, free and reserved bytes"){
+      auto report = pool.memory_report();
+      REQUIRE(report.live_nodes == 8);
+      REQUIRE(report.free_nodes == 1);
+      REQUIRE(report.reserved_nodes == pool.capacity() - 9);
+      REQUIRE(report.live_bytes == pool.memory_usage(small) + pool.memory_usage(big));
+      REQUIRE(report.free_bytes > 200);
+      REQUIRE(report.total_bytes() == report.live_bytes + report.free_bytes + report.reserved_bytes);
+    }
+  }
+}
+
+SCENARIO("segregating hot and cold lists"){
+  GIVEN("many lists of which one is traversed far more than the others"){
+    list_pool<int, std::size_t, vector_storage, no_log, access_sampler<1>> pool{};
+    std::vector<std::size_t> heads(8, pool.new_list());
+    for (int i = 0; i < 80; ++i)
+      heads[i % 8] = pool.push_front(i, heads[i % 8]);
+    for (int i = 0; i < 100; ++i)
+      std::accumulate(pool.begin(heads[5]), pool.end(heads[5]), 0);
+    std::accumulate(pool.begin(heads[2]), pool.end(heads[2]), 0);
+    // the observer belongs to the writer: const traversals are not counted
+    const auto& reader = pool;
+    std::accumulate(reader.begin(heads[3]), reader.end(heads[3]), 0);
+    std::vector<std::vector<int>> before;
+    for (auto head : heads)
+      before.emplace_back(pool.begin(head), pool.end(head));
+
+    THEN("the traversals have been counted per list"){
+      REQUIRE(pool.observer().heat(heads[3]) == 1);
+      REQUIRE(pool.observer().heat(heads[5]) >= 100);
+      REQUIRE(pool.observer().heat(heads[5]) > pool.observer().heat(heads[2]));
+    }
+    WHEN("we segregate them by heat"){
+      auto heat = [&pool](std::size_t head){ return pool.observer().heat(head); };
+      pool.segregate(heads, heat);
+      THEN("the hottest list comes first, then the warm one, the lists are unchanged"){
+        REQUIRE(heads[5] == 1);
+        REQUIRE(heads[2] == 11);
+        for (int i = 0; i < 8; ++i)
+          REQUIRE(std::equal(before[i].begin(), before[i].end(), pool.begin(heads[i]), pool.end(heads[i])));
+      }
+    }
+  }
+}
+
+SCENARIO("collecting leaked nodes"){
+  GIVEN("a pool where some heads have been dropped"){
+    list_pool<int, std::size_t, chunked_storage> pool{};
+    std::vector<std::size_t> roots(4, pool.new_list());
+    for (int i = 0; i < 4000; ++i)
+      roots[i % 4] = pool.push_front(i, roots[i % 4]);
+    auto shared = pool.push_front(-1, roots[3]); // shares the tail of the last root
+    roots.push_back(shared);
+    auto leaked = pool.new_list();
+    for (int i = 0; i < 500; ++i)
+      leaked = pool.push_front(i, leaked);
+    pool.free(pool.free(leaked)); // two nodes of the leaked list are free already
+    std::vector<std::vector<int>> before;
+    for (auto root : roots)
+      before.emplace_back(pool.begin(root), pool.end(root));
+
+    WHEN("we collect from the live roots, in parallel"){
+      auto reclaimed = pool.collect(roots, 4);
+
+      THEN("only the unreachable nodes are reclaimed"){
+        REQUIRE(reclaimed == 498);
+        for (std::size_t i = 0; i < roots.size(); ++i)
+          REQUIRE(std::equal(before[i].begin(), before[i].end(), pool.begin(roots[i]), pool.end(roots[i])));
+      }
+      THEN("they are reused in increasing order, before the nodes freed earlier"){
+        auto l = pool.push_front(0, pool.new_list());
+        REQUIRE(l == 4002);
+        REQUIRE(pool.memory_report().free_nodes == 500 - 1);
+      }
+      THEN("collecting again finds nothing")
+        REQUIRE(pool.collect(roots) == 0);
+    }
+  }
+}
+
+SCENARIO("persistent lists"){
+  GIVEN("a long list and two versions pushed onto it"){
+    persistent_list_pool<int, std::uint32_t> pool{};
+    auto common = pool.new_list();
+    for (int i = 0; i < 1000; ++i) {
+      auto longer = pool.push_front(i, common);
+      pool.release(common); // we only keep the newest version
+      common = longer;
+    }
+    auto a = pool.push_front(-1, common);
+    auto b = pool.push_front(-2, common);
+
+    THEN("each version costs a single node and sees the common tail"){
+      REQUIRE(pool.size() == 1002);
+      REQUIRE(*pool.begin(a) == -1);
+      REQUIRE(*pool.begin(b) == -2);
+      REQUIRE(std::distance(pool.begin(a), pool.end(a)) == 1001);
+      REQUIRE(std::equal(std::next(pool.begin(a)), pool.end(a), pool.begin(common), pool.end(common)));
+      REQUIRE(pool.refs(common) == 3);
+    }
+    WHEN("the versions are released one by one"){
+      REQUIRE(pool.release(a) == 1);
+      REQUIRE(pool.release(common) == 0);
+      THEN("the shared tail lives as long as some version uses it"){
+        REQUIRE(std::distance(pool.begin(b), pool.end(b)) == 1001);
+        REQUIRE(pool.release(b) == 1001);
+        REQUIRE(pool.nodes().memory_report().free_nodes == 1002);
+      }
+      THEN("releasing twice is caught")
+        REQUIRE_THROWS_AS(pool.release(a), std::logic_error);
+    }
+    WHEN("we take the rest of a version"){
+      auto rest = pool.rest(a);
+      REQUIRE(pool.release(a) == 1);
+      THEN("it is the common tail, with a reference of its own"){
+        REQUIRE(rest == common);
+        REQUIRE(pool.refs(common) == 3);
+      }
+    }
+  }
+}
+
+SCENARIO("small lists"){
+  GIVEN("a small list keeping three values inline"){
+    list_pool<std::string, std::uint32_t> pool{};
+    small_list<list_pool<std::string, std::uint32_t>, 3> list{pool};
+    REQUIRE(list.is_empty());
+    REQUIRE(list.begin(pool) == list.end(pool));
+
+    WHEN("it holds up to three values"){
+      list.push_back(pool, "b");
+      list.push_front(pool, "a");
+      list.push_back(pool, "c");
+      THEN("the pool is not used"){
+        REQUIRE(pool.size() == 0);
+        REQUIRE(list.inline_size() == 3);
+        REQUIRE_FALSE(list.has_spilled());
+        REQUIRE(list.front() == "a");
+        std::vector<std::string> expected{"a", "b", "c"};
+        REQUIRE(std::equal(list.begin(pool), list.end(pool), expected.begin(), expected.end()));
+      }
+    }
+    WHEN("it grows past three values at both ends"){
+      for (int i = 0; i < 5; ++i) list.push_back(pool, std::to_string(i));
+      list.push_front(pool, "-1");
+      list.push_front(pool, "-2");
+      THEN("the values past the third spill into the pool, in order"){
+        REQUIRE(list.has_spilled());
+        REQUIRE(pool.memory_report().live_nodes == 4);
+        std::vector<std::string> expected{"-2", "-1", "0", "1", "2", "3", "4"};
+        REQUIRE(std::equal(list.begin(pool), list.end(pool), expected.begin(), expected.end()));
+      }
+      AND_WHEN("values are popped"){
+        for (int i = 0; i < 4; ++i) list.pop_front(pool);
+        THEN("the pooled values come back inline and their nodes are freed"){
+          REQUIRE_FALSE(list.has_spilled());
+          REQUIRE(pool.memory_report().live_nodes == 0);
+          std::vector<std::string> expected{"2", "3", "4"};
+          REQUIRE(std::equal(list.begin(pool), list.end(pool), expected.begin(), expected.end()));
+        }
+      }
+      AND_WHEN("it is moved then freed"){
+        auto moved = std::move(list);
+        REQUIRE(list.is_empty());
+        REQUIRE(std::distance(moved.begin(pool), moved.end(pool)) == 7);
+        moved.free_list(pool);
+        THEN("every node is back in the pool"){
+          REQUIRE(moved.is_empty());
+          REQUIRE(pool.memory_report().live_nodes == 0);
+        }
+      }
+      AND_WHEN("it is assigned to another small list"){
+        using list_type = small_list<list_pool<std::string, std::uint32_t>, 3>;
+        static_assert(not std::is_move_assignable<list_type>::value, "assign() is the only way, it takes the pool");
+        list_type other{pool};
+        other.push_back(pool, "x");
+        other.assign(pool, std::move(list));
+        THEN("the values move over and the source is empty"){
+          REQUIRE(list.is_empty());
+          REQUIRE_FALSE(list.has_spilled());
+          std::vector<std::string> expected{"-2", "-1", "0", "1", "2", "3", "4"};
+          REQUIRE(std::equal(other.begin(pool), other.end(pool), expected.begin(), expected.end()));
+        }
+        AND_WHEN("a short list is assigned over the spilled one"){
+          list_type third{pool};
+          for (int i = 0; i < 3; ++i) third.push_back(pool, std::to_string(i));
+          other.assign(pool, std::move(third));
+          THEN("the pooled nodes of the target go back to the pool first"){
+            REQUIRE(pool.memory_report().live_nodes == 0);
+            REQUIRE(third.is_empty());
+            std::vector<std::string> expected{"0", "1", "2"};
+            REQUIRE(std::equal(other.begin(pool), other.end(pool), expected.begin(), expected.end()));
+          }
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("records on several lists"){
+  GIVEN("a pool of records with a link per user and a link per session"){
+    enum { by_user, by_session };
+    multi_list_pool<std::string, 2, std::uint32_t> pool{};
+    std::vector<std::uint32_t> users(2, pool.new_list()), sessions(3, pool.new_list());
+    for (int i = 0; i < 12; ++i) {
+      auto record = pool.new_record("event " + std::to_string(i));
+      users[i % 2] = pool.push_front<by_user>(record, users[i % 2]);
+      sessions[i % 3] = pool.push_front<by_session>(record, sessions[i % 3]);
+    }
+
+    THEN("each record is stored once and found through both links"){
+      REQUIRE(pool.size() == 12);
+      std::vector<std::string> user1(pool.begin<by_user>(users[1]), pool.end<by_user>(users[1]));
+      REQUIRE(user1 == std::vector<std::string>{"event 11", "event 9", "event 7", "event 5", "event 3", "event 1"});
+      std::vector<std::string> session0(pool.begin<by_session>(sessions[0]), pool.end<by_session>(sessions[0]));
+      REQUIRE(session0 == std::vector<std::string>{"event 9", "event 6", "event 3", "event 0"});
+      pool.value(users[1]) += " (edited)";
+      REQUIRE(*pool.begin<by_session>(sessions[2]) == "event 11 (edited)");
+    }
+    THEN("a record is on a single list per link")
+      REQUIRE_THROWS_AS(pool.push_front<by_user>(users[0], users[1]), std::logic_error);
+
+    WHEN("the lists of one link are freed"){
+      for (auto& head : users) head = pool.free_list<by_user>(head);
+      THEN("the records stay, as the other link still holds them"){
+        REQUIRE(std::distance(pool.begin<by_session>(sessions[1]), pool.end<by_session>(sessions[1])) == 4);
+        REQUIRE_FALSE(pool.is_linked<by_user>(sessions[1]));
+        auto reused = pool.new_record("new");
+        REQUIRE(reused == 13);
+      }
+      AND_WHEN("the lists of the other link are freed too"){
+        for (auto& head : sessions) head = pool.free_list<by_session>(head);
+        THEN("the nodes are reused"){
+          for (int i = 0; i < 12; ++i) REQUIRE(pool.new_record("again") <= 12);
+          REQUIRE(pool.size() == 12);
+        }
+      }
+    }
+
+    WHEN("a record that was never linked is released"){
+      auto lone = pool.new_record("lone");
+      pool.release(lone);
+      THEN("releasing or linking it again is rejected, and the free list stays sound"){
+        REQUIRE_THROWS_AS(pool.release(lone), std::logic_error);
+        REQUIRE_THROWS_AS(pool.push_front<by_user>(lone, users[0]), std::logic_error);
+        REQUIRE(pool.new_record("first") == lone);
+        REQUIRE(pool.new_record("second") == 14);
+      }
+    }
+  }
+}
+
+SCENARIO("lists over an external table of values"){
+  GIVEN("a link pool and a table holding the values"){
+    link_pool<std::uint32_t> links{};
+    std::vector<double> prices;
+    auto put = [&](std::uint32_t slot, double price) {
+      if (prices.size() < links.size()) prices.resize(links.size());
+      prices[links.position(slot)] = price;
+    };
+    auto a = links.new_list(), b = links.new_list();
+    for (int i = 0; i < 3; ++i) {
+      a = links.push_front(a);
+      put(a, i);
+    }
+    b = links.push_back(b);
+    put(b, 10);
+    b = links.push_back(b);
+    put(links.next(b), 20);
+
+    THEN("the iterators read the values from the table"){
+      REQUIRE(links.size() == 5);
+      REQUIRE(prices.size() == 5);
+      std::vector<double> expected_a{2, 1, 0}, expected_b{10, 20};
+      REQUIRE(std::equal(links.begin(a, prices), links.end(a, prices), expected_a.begin(), expected_a.end()));
+      const auto& table = prices;
+      REQUIRE(std::equal(links.begin(b, table), links.end(b, table), expected_b.begin(), expected_b.end()));
+    }
+    THEN("the values can be written through the iterators"){
+      for (auto it = links.begin(a, prices); it != links.end(a, prices); ++it) *it *= 2;
+      REQUIRE(std::accumulate(links.begin(a, prices), links.end(a, prices), 0.0) == 6);
+    }
+    WHEN("lists are freed"){
+      a = links.free(a);
+      b = links.free_list(b);
+      THEN("their slots are handed out again, the table does not grow"){
+        REQUIRE(links.begin(a, prices) != links.end(a, prices));
+        REQUIRE(*links.begin(a, prices) == 1);
+        std::uint32_t c{links.new_list()};
+        for (int i = 0; i < 3; ++i) c = links.push_front(c);
+        REQUIRE(links.size() == 5);
+      }
+    }
+  }
+  GIVEN("a link pool over chunked storage"){
+    link_pool<std::uint32_t, chunked_storage> links{};
+    std::vector<int> values(10000); // the slots fill three chunks
+    auto l = links.new_list();
+    for (int i = 0; i < 10000; ++i) {
+      l = links.push_front(l);
+      values[links.position(l)] = i;
+    }
+    THEN("the list reads back in order"){
+      REQUIRE(links.size() == 10000);
+      REQUIRE(*links.begin(l, values) == 9999);
+      REQUIRE(std::accumulate(links.begin(l, values), links.end(l, values), 0L) == 9999L * 10000 / 2);
+      l = links.free_list(l);
+      REQUIRE(links.is_empty(l));
+    }
+  }
+}
+
+SCENARIO("circular lists"){
+  GIVEN("two rings built at both ends"){
+    circular_list_pool<int, std::uint32_t> pool{};
+    auto a = pool.new_list(), b = pool.new_list();
+    REQUIRE(pool.begin(a) == pool.end(a));
+    for (int i = 1; i <= 3; ++i) a = pool.push_back(i, a);
+    a = pool.push_front(0, a);
+    for (int i = 10; i < 12; ++i) b = pool.push_back(i, b);
+
+    THEN("the iterators make one lap from the head"){
+      REQUIRE(pool.front(a) == 0);
+      REQUIRE(pool.back(a) == 3);
+      std::vector<int> expected{0, 1, 2, 3};
+      REQUIRE(std::equal(pool.begin(a), pool.end(a), expected.begin(), expected.end()));
+    }
+    WHEN("they are concatenated"){
+      auto c = pool.concat(a, b);
+      THEN("the result is a single ring"){
+        std::vector<int> expected{0, 1, 2, 3, 10, 11};
+        REQUIRE(std::equal(pool.begin(c), pool.end(c), expected.begin(), expected.end()));
+        REQUIRE(pool.back(c) == 11);
+      }
+      AND_WHEN("the ring is rotated"){
+        c = pool.rotate(c, 2);
+        std::vector<int> expected{2, 3, 10, 11, 0, 1};
+        REQUIRE(std::equal(pool.begin(c), pool.end(c), expected.begin(), expected.end()));
+        REQUIRE(pool.rotate(c, 6) == c);
+      }
+      AND_WHEN("the ring is freed"){
+        c = pool.free_list(c);
+        THEN("all its nodes are on the free list and are reused"){
+          REQUIRE(pool.is_empty(c));
+          REQUIRE(pool.nodes().memory_report().free_nodes == 6);
+          for (int i = 0; i < 6; ++i) c = pool.push_front(i, c);
+          REQUIRE(pool.size() == 6);
+          REQUIRE(pool.length(c) == 6);
+        }
+      }
+    }
+    WHEN("the heads are popped"){
+      a = pool.free(a);
+      b = pool.free(pool.free(b));
+      THEN("the rings shrink, down to empty"){
+        REQUIRE(pool.length(a) == 3);
+        REQUIRE(pool.front(a) == 1);
+        REQUIRE(pool.is_empty(b));
+        REQUIRE(pool.nodes().memory_report().free_nodes == 3);
+      }
+    }
+  }
+}
+
+SCENARIO("merging pools and extracting lists"){
+  GIVEN("two pools with lists and free nodes"){
+    list_pool<int, std::uint32_t> pool{}, shard{};
+    auto a = pool.new_list(), x = shard.new_list(), y = shard.new_list();
+    for (int i = 0; i < 3; ++i) a = pool.push_front(i, a);
+    for (int i = 0; i < 4; ++i) x = shard.push_front(10 + i, x);
+    for (int i = 0; i < 2; ++i) y = shard.push_back(20 + i, y);
+    x = shard.free(x);
+
+    WHEN("a pool absorbs the other"){
+      auto offset = pool.absorb(shard);
+      THEN("the lists of the other pool are found at their heads plus the offset"){
+        REQUIRE(offset == 3);
+        REQUIRE(pool.size() == 9);
+        auto merged_x = x + offset, merged_y = y + offset;
+        REQUIRE(std::equal(pool.cbegin(merged_x), pool.cend(merged_x), shard.cbegin(x), shard.cend(x)));
+        REQUIRE(std::equal(pool.cbegin(merged_y), pool.cend(merged_y), shard.cbegin(y), shard.cend(y)));
+        std::vector<int> expected_a{2, 1, 0};
+        REQUIRE(std::equal(pool.cbegin(a), pool.cend(a), expected_a.begin(), expected_a.end()));
+      }
+      THEN("its free nodes are reused"){
+        REQUIRE(pool.memory_report().free_nodes == 1);
+        pool.push_front(99, pool.new_list());
+        REQUIRE(pool.size() == 9);
+      }
+    }
+    WHEN("lists are extracted, two of them sharing a tail"){
+      auto z = pool.push_front(7, pool.next(a));
+      std::vector<std::uint32_t> heads{z, a};
+      auto extracted = pool.extract(heads);
+      THEN("the new pool holds them alone, contiguously in traversal order"){
+        REQUIRE(extracted.size() == 4);
+        REQUIRE(heads == std::vector<std::uint32_t>{1, 4});
+        REQUIRE(extracted.next(1) == 2);
+        REQUIRE(extracted.next(4) == 2);
+        REQUIRE(std::equal(extracted.cbegin(heads[0]), extracted.cend(heads[0]), pool.cbegin(z), pool.cend(z)));
+        REQUIRE(std::equal(extracted.cbegin(heads[1]), extracted.cend(heads[1]), pool.cbegin(a), pool.cend(a)));
+        REQUIRE(extracted.memory_report().free_nodes == 0);
+      }
+    }
+  }
+
+  GIVEN("a pool of many interleaved lists"){
+    list_pool<int, std::uint32_t> pool{};
+    std::vector<std::uint32_t> lists(100, pool.new_list());
+    for (int i = 0; i < 10000; ++i)
+      lists[i % 100] = pool.push_front(i, lists[i % 100]);
+
+    WHEN("every other list is extracted, one of them twice"){
+      std::vector<std::uint32_t> heads;
+      for (std::size_t i = 0; i < lists.size(); i += 2) heads.push_back(lists[i]);
+      heads.push_back(lists[0]);
+      auto extracted = pool.extract(heads);
+      THEN("each node is copied once and the lists are intact"){
+        REQUIRE(extracted.size() == 5000);
+        REQUIRE(heads.back() == heads.front());
+        for (std::size_t i = 0; i < 50; ++i)
+          REQUIRE(std::equal(extracted.cbegin(heads[i]), extracted.cend(heads[i]), pool.cbegin(lists[2 * i]), pool.cend(lists[2 * i])));
+      }
+    }
+  }
+}